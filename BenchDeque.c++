@@ -0,0 +1,952 @@
+// -----------------------------
+// projects/deque/BenchDeque.c++
+// Copyright (C) 2014
+// Glenn P. Downing
+// -----------------------------
+
+// https://github.com/google/benchmark
+
+/*
+Google Benchmark Libraries:
+    % ls -al /usr/include/benchmark/
+    ...
+    benchmark.h
+    ...
+
+To compile the benchmark (GCC 5 or later, for std::is_trivially_copyable):
+    % g++ -O3 -DNDEBUG -pedantic -std=c++11 -Wall BenchDeque.c++ -o BenchDeque -lbenchmark -lpthread
+
+To run the benchmark:
+    % BenchDeque
+
+To run it and keep the results as JSON, for tracking regressions:
+    % BenchDeque --benchmark_out=BenchDeque.json --benchmark_out_format=json
+*/
+
+// --------
+// includes
+// --------
+
+#include <algorithm> // count, min, sort
+#include <atomic>    // atomic
+#include <chrono>    // steady_clock
+#include <cstdio>    // fclose, fopen, fread, fwrite, remove
+#include <cstddef>   // size_t
+#include <cstdint>   // uint64_t
+#include <deque>     // deque
+#include <fstream>   // ifstream, ofstream
+#include <memory>    // allocator
+#include <mutex>     // lock_guard, mutex
+#include <string>    // string
+#include <thread>    // thread
+#include <vector>    // vector
+
+#include "benchmark/benchmark.h"
+
+#include "BlockPool.h"
+#include "BoundedDeque.h"
+#include "CowDeque.h"
+#include "Deque.h"
+#include "DequeIO.h"
+#include "MappedDeque.h"
+#include "ParallelDeque.h"
+#include "SPSCDeque.h"
+#include "SmallDeque.h"
+#include "WorkStealingDeque.h"
+
+// ----------
+// block_size
+// ----------
+
+// my_deque<std::uint64_t> with an explicit block size; the last entry is the
+// 4 KiB default (512 elements), 10 is the block size the deque used to hard-code.
+
+typedef std::uint64_t value_type;
+
+template <std::size_t B>
+using block_deque = my_deque<value_type, std::allocator<value_type>, B>;
+
+#define BENCH_BLOCK_SIZES(F)                                         \
+    BENCHMARK_TEMPLATE(F, block_deque<10>)->Range(1 << 10, 1 << 20);  \
+    BENCHMARK_TEMPLATE(F, block_deque<16>)->Range(1 << 10, 1 << 20);  \
+    BENCHMARK_TEMPLATE(F, block_deque<64>)->Range(1 << 10, 1 << 20);  \
+    BENCHMARK_TEMPLATE(F, block_deque<100>)->Range(1 << 10, 1 << 20); \
+    BENCHMARK_TEMPLATE(F, block_deque<256>)->Range(1 << 10, 1 << 20); \
+    BENCHMARK_TEMPLATE(F, my_deque<value_type>)->Range(1 << 10, 1 << 20)
+
+// ---------------
+// BM_index_linear
+// ---------------
+
+template <typename D>
+void BM_index_linear (benchmark::State& state) {
+    const std::size_t n = state.range(0);
+    D x(n, 1);
+    for (auto _ : state) {
+        value_type sum = 0;
+        for (std::size_t i = 0; i != n; ++i)
+            sum += x[i];
+        benchmark::DoNotOptimize(sum);}
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCH_BLOCK_SIZES(BM_index_linear);
+
+// ---------------
+// BM_index_random
+// ---------------
+
+template <typename D>
+void BM_index_random (benchmark::State& state) {
+    const std::size_t n = state.range(0);
+    D x(n, 1);
+    std::vector<std::size_t> p(n);
+    std::uint64_t r = 88172645463325252ull;
+    for (std::size_t i = 0; i != n; ++i) {
+        r ^= r << 13;
+        r ^= r >> 7;
+        r ^= r << 17;
+        p[i] = r % n;}
+    for (auto _ : state) {
+        value_type sum = 0;
+        for (std::size_t i = 0; i != n; ++i)
+            sum += x[p[i]];
+        benchmark::DoNotOptimize(sum);}
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCH_BLOCK_SIZES(BM_index_random);
+
+// ----------
+// BM_iterate
+// ----------
+
+template <typename D>
+void BM_iterate (benchmark::State& state) {
+    const std::size_t n = state.range(0);
+    D x(n, 1);
+    for (auto _ : state) {
+        value_type sum = 0;
+        for (typename D::const_iterator b = x.begin(), e = x.end(); b != e; ++b)
+            sum += *b;
+        benchmark::DoNotOptimize(sum);}
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCH_BLOCK_SIZES(BM_iterate);
+
+// -------
+// BM_sort
+// -------
+
+template <typename D>
+void BM_sort (benchmark::State& state) {
+    const std::size_t n = state.range(0);
+    for (auto _ : state) {
+        state.PauseTiming();
+        D x(n);
+        std::uint64_t r = 88172645463325252ull;
+        for (typename D::iterator b = x.begin(), e = x.end(); b != e; ++b) {
+            r ^= r << 13;
+            r ^= r >> 7;
+            r ^= r << 17;
+            *b = r;}
+        state.ResumeTiming();
+        std::sort(x.begin(), x.end());
+        benchmark::DoNotOptimize(x.front());}
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCH_BLOCK_SIZES(BM_sort);
+
+// ----------
+// containers
+// ----------
+
+// per-operation suite: my_deque against std::deque for the element types of
+// the test suite's my_types plus a non-trivial one, at sizes 10 to 10^8
+// (10^6 for strings, which would not fit in memory beyond that);
+// compile with -DBENCH_MAX_SIZE=<n> for a quicker run
+
+#ifndef BENCH_MAX_SIZE
+#define BENCH_MAX_SIZE 100000000
+#endif
+
+template <typename T>
+struct max_size {
+    static const std::int64_t value = BENCH_MAX_SIZE;};
+
+template <>
+struct max_size<std::string> {
+    static const std::int64_t value = (BENCH_MAX_SIZE < 1000000) ? BENCH_MAX_SIZE : 1000000;};
+
+/**
+ * Powers of ten from 10 up to the limit for the element type of D.
+ */
+template <typename D>
+void sizes (benchmark::internal::Benchmark* b) {
+    b->RangeMultiplier(10)->Range(10, max_size<typename D::value_type>::value);}
+
+/**
+ * sizes crossed with an insert/erase position, in percent of the size.
+ */
+template <typename D>
+void positions (benchmark::internal::Benchmark* b) {
+    for (std::int64_t n = 10; n <= max_size<typename D::value_type>::value; n *= 10)
+        for (std::int64_t p = 0; p <= 100; p += 25)
+            b->Args({n, p});}
+
+#define BENCH_TYPES(F, A)                                                \
+    BENCHMARK_TEMPLATE(F, std::deque<int>)->Apply(A<std::deque<int> >);  \
+    BENCHMARK_TEMPLATE(F, my_deque<int>)->Apply(A<my_deque<int> >);      \
+    BENCHMARK_TEMPLATE(F, std::deque<double>)->Apply(A<std::deque<double> >); \
+    BENCHMARK_TEMPLATE(F, my_deque<double>)->Apply(A<my_deque<double> >);     \
+    BENCHMARK_TEMPLATE(F, std::deque<std::string>)->Apply(A<std::deque<std::string> >); \
+    BENCHMARK_TEMPLATE(F, my_deque<std::string>)->Apply(A<my_deque<std::string> >)
+
+// ----------
+// make_value
+// ----------
+
+/**
+ * The i-th test value; strings are long enough to live on the heap.
+ */
+template <typename T>
+T make_value (std::size_t i) {
+    return T(i);}
+
+template <>
+std::string make_value<std::string> (std::size_t i) {
+    return std::string(24, char('a' + (i % 26)));}
+
+// -----
+// touch
+// -----
+
+/**
+ * Reads v so that the compiler has to load it.
+ */
+template <typename T>
+std::size_t touch (const T& v) {
+    return static_cast<std::size_t>(v);}
+
+std::size_t touch (const std::string& v) {
+    return v.size();}
+
+// ----
+// fill
+// ----
+
+template <typename D>
+D fill (std::size_t n) {
+    D x;
+    for (std::size_t i = 0; i != n; ++i)
+        x.push_back(make_value<typename D::value_type>(i));
+    return x;}
+
+// ------------
+// BM_push_back
+// ------------
+
+template <typename D>
+void BM_push_back (benchmark::State& state) {
+    typedef typename D::value_type T;
+    const std::size_t n = state.range(0);
+    const T v = make_value<T>(n);
+    for (auto _ : state) {
+        D x;
+        for (std::size_t i = 0; i != n; ++i)
+            x.push_back(v);
+        benchmark::DoNotOptimize(x.size());}
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCH_TYPES(BM_push_back, sizes);
+BENCH_BLOCK_SIZES(BM_push_back);
+
+// -------------
+// BM_push_front
+// -------------
+
+template <typename D>
+void BM_push_front (benchmark::State& state) {
+    typedef typename D::value_type T;
+    const std::size_t n = state.range(0);
+    const T v = make_value<T>(n);
+    for (auto _ : state) {
+        D x;
+        for (std::size_t i = 0; i != n; ++i)
+            x.push_front(v);
+        benchmark::DoNotOptimize(x.size());}
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCH_TYPES(BM_push_front, sizes);
+
+// -----------
+// BM_pop_back
+// -----------
+
+// a stack: n push_backs, then n pop_backs
+
+template <typename D>
+void BM_pop_back (benchmark::State& state) {
+    typedef typename D::value_type T;
+    const std::size_t n = state.range(0);
+    const T v = make_value<T>(n);
+    D x;
+    for (auto _ : state) {
+        for (std::size_t i = 0; i != n; ++i)
+            x.push_back(v);
+        while (!x.empty())
+            x.pop_back();
+        benchmark::DoNotOptimize(x.size());}
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCH_TYPES(BM_pop_back, sizes);
+
+// ------------
+// BM_pop_front
+// ------------
+
+// a queue: n push_backs, then n pop_fronts
+
+template <typename D>
+void BM_pop_front (benchmark::State& state) {
+    typedef typename D::value_type T;
+    const std::size_t n = state.range(0);
+    const T v = make_value<T>(n);
+    D x;
+    for (auto _ : state) {
+        for (std::size_t i = 0; i != n; ++i)
+            x.push_back(v);
+        while (!x.empty())
+            x.pop_front();
+        benchmark::DoNotOptimize(x.size());}
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCH_TYPES(BM_pop_front, sizes);
+
+// -------
+// BM_fifo
+// -------
+
+// a queue of steady size n: one push_back and one pop_front per item
+
+template <typename D>
+void BM_fifo (benchmark::State& state) {
+    typedef typename D::value_type T;
+    const std::size_t n = state.range(0);
+    const T v = make_value<T>(n);
+    D x = fill<D>(n);
+    for (auto _ : state) {
+        for (std::size_t i = 0; i != n; ++i) {
+            x.push_back(v);
+            x.pop_front();}
+        benchmark::DoNotOptimize(x.size());}
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCH_TYPES(BM_fifo, sizes);
+
+// ------------
+// BM_subscript
+// ------------
+
+// operator [] at random indices
+
+template <typename D>
+void BM_subscript (benchmark::State& state) {
+    const std::size_t n = state.range(0);
+    const D x = fill<D>(n);
+    const std::size_t m = std::min<std::size_t>(n, 1 << 20);
+    std::vector<std::size_t> p(m);
+    std::uint64_t r = 88172645463325252ull;
+    for (std::size_t i = 0; i != m; ++i) {
+        r ^= r << 13;
+        r ^= r >> 7;
+        r ^= r << 17;
+        p[i] = r % n;}
+    for (auto _ : state) {
+        std::size_t sum = 0;
+        for (std::size_t i = 0; i != m; ++i)
+            sum += touch(x[p[i]]);
+        benchmark::DoNotOptimize(sum);}
+    state.SetItemsProcessed(state.iterations() * m);}
+
+BENCH_TYPES(BM_subscript, sizes);
+
+// ----------------
+// BM_random_access
+// ----------------
+
+// operator [] and at() at 2^20 random indices into 10^7 ints whose front is
+// not at the start of a block, so the front offset is never zero
+
+template <typename D>
+D random_access_fill () {
+    D x;
+    for (int i = 0; i != 10000000 - 3; ++i)
+        x.push_back(i);
+    for (int i = 0; i != 3; ++i)
+        x.push_front(i);
+    return x;}
+
+std::vector<std::size_t> random_access_indices (std::size_t n) {
+    std::vector<std::size_t> p(1 << 20);
+    std::uint64_t r = 88172645463325252ull;
+    for (std::size_t i = 0; i != p.size(); ++i) {
+        r ^= r << 13;
+        r ^= r >> 7;
+        r ^= r << 17;
+        p[i] = r % n;}
+    return p;}
+
+template <typename D>
+void BM_random_access_subscript (benchmark::State& state) {
+    const D x = random_access_fill<D>();
+    const std::vector<std::size_t> p = random_access_indices(x.size());
+    for (auto _ : state) {
+        std::size_t sum = 0;
+        for (std::size_t i = 0; i != p.size(); ++i)
+            sum += x[p[i]];
+        benchmark::DoNotOptimize(sum);}
+    state.SetItemsProcessed(state.iterations() * p.size());}
+
+template <typename D>
+void BM_random_access_at (benchmark::State& state) {
+    const D x = random_access_fill<D>();
+    const std::vector<std::size_t> p = random_access_indices(x.size());
+    for (auto _ : state) {
+        std::size_t sum = 0;
+        for (std::size_t i = 0; i != p.size(); ++i)
+            sum += x.at(p[i]);
+        benchmark::DoNotOptimize(sum);}
+    state.SetItemsProcessed(state.iterations() * p.size());}
+
+BENCHMARK_TEMPLATE(BM_random_access_subscript, std::deque<int>);
+BENCHMARK_TEMPLATE(BM_random_access_subscript, my_deque<int>);
+BENCHMARK_TEMPLATE(BM_random_access_at, std::deque<int>);
+BENCHMARK_TEMPLATE(BM_random_access_at, my_deque<int>);
+
+// ------------
+// BM_iteration
+// ------------
+
+template <typename D>
+void BM_iteration (benchmark::State& state) {
+    const std::size_t n = state.range(0);
+    const D x = fill<D>(n);
+    for (auto _ : state) {
+        std::size_t sum = 0;
+        for (typename D::const_iterator b = x.begin(), e = x.end(); b != e; ++b)
+            sum += touch(*b);
+        benchmark::DoNotOptimize(sum);}
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCH_TYPES(BM_iteration, sizes);
+
+// --------
+// BM_count
+// --------
+
+// unqualified, so my_deque gets its segmented count
+
+template <typename D>
+void BM_count (benchmark::State& state) {
+    typedef typename D::value_type T;
+    const std::size_t n = state.range(0);
+    const D x = fill<D>(n);
+    const T v = make_value<T>(n / 2);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(count(x.begin(), x.end(), v));
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCH_TYPES(BM_count, sizes);
+
+// --------
+// BM_equal
+// --------
+
+template <typename D>
+void BM_equal (benchmark::State& state) {
+    const std::size_t n = state.range(0);
+    const D x = fill<D>(n);
+    const D y(x);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(x == y);
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCH_TYPES(BM_equal, sizes);
+
+// ---------------
+// BM_insert_erase
+// ---------------
+
+// one insert and one erase at range(1) percent of the way from the front
+
+template <typename D>
+void BM_insert_erase (benchmark::State& state) {
+    typedef typename D::value_type T;
+    const std::size_t n = state.range(0);
+    const std::size_t k = (n * state.range(1)) / 100;
+    const T v = make_value<T>(n);
+    D x = fill<D>(n);
+    for (auto _ : state) {
+        x.insert(x.begin() + k, v);
+        x.erase(x.begin() + k);
+        benchmark::DoNotOptimize(x.size());}
+    state.SetItemsProcessed(state.iterations() * 2);}
+
+BENCH_TYPES(BM_insert_erase, positions);
+
+// -------
+// BM_copy
+// -------
+
+template <typename D>
+void BM_copy (benchmark::State& state) {
+    const std::size_t n = state.range(0);
+    const D x = fill<D>(n);
+    for (auto _ : state) {
+        D y(x);
+        benchmark::DoNotOptimize(y.size());}
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCH_TYPES(BM_copy, sizes);
+
+// ---------
+// BM_assign
+// ---------
+
+// assignment over an existing deque of the same size
+
+template <typename D>
+void BM_assign (benchmark::State& state) {
+    const std::size_t n = state.range(0);
+    const D y = fill<D>(n);
+    D x = fill<D>(n);
+    for (auto _ : state) {
+        x = y;
+        benchmark::DoNotOptimize(x.size());}
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCH_TYPES(BM_assign, sizes);
+
+// ---------
+// BM_resize
+// ---------
+
+// shrink to half and grow back
+
+template <typename D>
+void BM_resize (benchmark::State& state) {
+    typedef typename D::value_type T;
+    const std::size_t n = state.range(0);
+    const T v = make_value<T>(n);
+    D x = fill<D>(n);
+    for (auto _ : state) {
+        x.resize(n / 2);
+        x.resize(n, v);
+        benchmark::DoNotOptimize(x.size());}
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCH_TYPES(BM_resize, sizes);
+
+// --------
+// BM_batch
+// --------
+
+// an ingest loop: batches of range(0) elements added at the back one
+// push_back at a time, or with one append
+
+void BM_batch_push (benchmark::State& state) {
+    const std::size_t n = state.range(0);
+    const std::vector<value_type> v(n, 1);
+    for (auto _ : state) {
+        my_deque<value_type> x;
+        for (int k = 0; k != 64; ++k)
+            for (std::size_t i = 0; i != n; ++i)
+                x.push_back(v[i]);
+        benchmark::DoNotOptimize(x.size());}
+    state.SetItemsProcessed(state.iterations() * 64 * n);}
+
+void BM_batch_append (benchmark::State& state) {
+    const std::size_t n = state.range(0);
+    const std::vector<value_type> v(n, 1);
+    for (auto _ : state) {
+        my_deque<value_type> x;
+        for (int k = 0; k != 64; ++k)
+            x.append(v.data(), v.data() + n);
+        benchmark::DoNotOptimize(x.size());}
+    state.SetItemsProcessed(state.iterations() * 64 * n);}
+
+BENCHMARK(BM_batch_push)->Arg(64)->Arg(4096);
+BENCHMARK(BM_batch_append)->Arg(64)->Arg(4096);
+
+// --------
+// BM_churn
+// --------
+
+// queues built and torn down back to back: block traffic with operator new
+// against a per-thread cache in front of a shared arena
+
+typedef my_deque<value_type, block_pool_allocator<value_type> > pool_deque;
+
+void BM_churn (benchmark::State& state, const block_pool_allocator<value_type>& a) {
+    const std::size_t n = state.range(0);
+    for (auto _ : state) {
+        pool_deque x(a);
+        for (std::size_t i = 0; i != n; ++i)
+            x.push_back(i);
+        while (!x.empty())
+            x.pop_front();
+        benchmark::DoNotOptimize(x.size());}
+    state.SetItemsProcessed(state.iterations() * n);}
+
+block_arena arena(block_bytes<pool_deque>::value);
+
+BENCHMARK_CAPTURE(BM_churn, new,   block_pool_allocator<value_type>())->Range(1 << 10, 1 << 18);
+BENCHMARK_CAPTURE(BM_churn, arena, block_pool_allocator<value_type>(arena))->Range(1 << 10, 1 << 18);
+
+// ------------
+// locked_deque
+// ------------
+
+// the mutex-wrapped my_deque that spsc_deque replaces as a hand-off queue
+
+template <typename T>
+class locked_deque {
+    private:
+        std::mutex  _m;
+        my_deque<T> _x;
+
+    public:
+        void push_back (const T& v) {
+            std::lock_guard<std::mutex> lock(_m);
+            _x.push_back(v);}
+
+        bool pop_front (T& v) {
+            std::lock_guard<std::mutex> lock(_m);
+            if (_x.empty())
+                return false;
+            v = _x.front();
+            _x.pop_front();
+            return true;}};
+
+// ----------
+// BM_handoff
+// ----------
+
+// one producer thread pushing n elements to one consumer thread
+
+template <typename Q>
+void BM_handoff (benchmark::State& state) {
+    const std::size_t n = state.range(0);
+    for (auto _ : state) {
+        Q x;
+        value_type sum = 0;
+        std::thread c([&] () {
+            for (std::size_t i = 0; i != n;) {
+                value_type v;
+                if (x.pop_front(v)) {
+                    sum += v;
+                    ++i;}}});
+        for (std::size_t i = 0; i != n; ++i)
+            x.push_back(i);
+        c.join();
+        benchmark::DoNotOptimize(sum);}
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCHMARK_TEMPLATE(BM_handoff, locked_deque<value_type>)->Range(1 << 16, 1 << 22)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_handoff, spsc_deque<value_type>)->Range(1 << 16, 1 << 22)->UseRealTime();
+
+// --------
+// BM_steal
+// --------
+
+// a binary tree of 2^depth small tasks spawned on a pool of k workers
+
+void steal_tree (work_stealing_pool& p, int depth, std::atomic<std::size_t>& leaves) {
+    if (depth == 0) {
+        leaves.fetch_add(1, std::memory_order_relaxed);
+        return;}
+    p.spawn([&p, depth, &leaves] () {steal_tree(p, depth - 1, leaves);});
+    p.spawn([&p, depth, &leaves] () {steal_tree(p, depth - 1, leaves);});}
+
+void BM_steal (benchmark::State& state) {
+    const int depth = 16;
+    work_stealing_pool p(state.range(0));
+    for (auto _ : state) {
+        std::atomic<std::size_t> leaves(0);
+        p.submit([&] () {steal_tree(p, depth, leaves);});
+        p.wait();
+        benchmark::DoNotOptimize(leaves.load());}
+    state.SetItemsProcessed(state.iterations() * ((2 << depth) - 1));}
+
+BENCHMARK(BM_steal)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+// -----------
+// BM_parallel
+// -----------
+
+// the parallel algorithms over 2^24 ints on 1 to 8 workers
+
+typedef my_deque<value_type> parallel_deque;
+
+parallel_deque parallel_fill () {
+    parallel_deque x;
+    value_type r = 1;
+    x.append_n(1 << 24, [&] () {
+        r = (r * 6364136223846793005ull) + 1442695040888963407ull;
+        return r >> 40;});
+    return x;}
+
+void BM_parallel_for_each (benchmark::State& state) {
+    work_stealing_pool p(state.range(0));
+    parallel_deque x = parallel_fill();
+    for (auto _ : state)
+        for_each(par(p), x, [] (value_type& v) {v = (v * 3) + 1;});
+    state.SetItemsProcessed(state.iterations() * x.size());}
+
+void BM_parallel_reduce (benchmark::State& state) {
+    work_stealing_pool p(state.range(0));
+    const parallel_deque x = parallel_fill();
+    for (auto _ : state)
+        benchmark::DoNotOptimize(reduce(par(p), x, value_type(0)));
+    state.SetItemsProcessed(state.iterations() * x.size());}
+
+void BM_parallel_sort (benchmark::State& state) {
+    work_stealing_pool p(state.range(0));
+    const parallel_deque y = parallel_fill();
+    for (auto _ : state) {
+        state.PauseTiming();
+        parallel_deque x(y);
+        state.ResumeTiming();
+        sort(par(p), x);}
+    state.SetItemsProcessed(state.iterations() * y.size());}
+
+BENCHMARK(BM_parallel_for_each)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+BENCHMARK(BM_parallel_reduce)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+BENCHMARK(BM_parallel_sort)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime();
+
+// ---------
+// BM_reopen
+// ---------
+
+// getting 2^24 ints back after a restart: reopening a mapped_deque
+// against reading a flat file into a my_deque
+
+const char* const mapped_path = "/tmp/BenchDeque_mapped.bin";
+const char* const flat_path   = "/tmp/BenchDeque_flat.bin";
+
+void BM_reopen_mapped (benchmark::State& state) {
+    const std::size_t n = 1 << 24;
+    std::remove(mapped_path);
+    {
+    mapped_deque<value_type> x(mapped_path);
+    for (std::size_t i = 0; i != n; ++i)
+        x.push_back(i);
+    x.flush();
+    }
+    for (auto _ : state) {
+        mapped_deque<value_type> x(mapped_path);
+        benchmark::DoNotOptimize(x.back());}
+    std::remove(mapped_path);
+    state.SetItemsProcessed(state.iterations() * n);}
+
+void BM_reopen_flat (benchmark::State& state) {
+    const std::size_t n = 1 << 24;
+    std::vector<value_type> v(1 << 16);
+    FILE* f = std::fopen(flat_path, "wb");
+    for (std::size_t i = 0; i != n; i += v.size()) {
+        for (std::size_t j = 0; j != v.size(); ++j)
+            v[j] = i + j;
+        std::fwrite(v.data(), sizeof(value_type), v.size(), f);}
+    std::fclose(f);
+    for (auto _ : state) {
+        my_deque<value_type> x;
+        FILE* g = std::fopen(flat_path, "rb");
+        std::size_t k;
+        while ((k = std::fread(v.data(), sizeof(value_type), v.size(), g)) != 0)
+            x.append(v.data(), v.data() + k);
+        std::fclose(g);
+        benchmark::DoNotOptimize(x.back());}
+    std::remove(flat_path);
+    state.SetItemsProcessed(state.iterations() * n);}
+
+BENCHMARK(BM_reopen_mapped)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_reopen_flat)->Unit(benchmark::kMicrosecond);
+
+// -------------
+// BM_checkpoint
+// -------------
+
+// a 2^22-element checkpoint written and read back element by element
+// through a stream, against write_deque and read_deque
+
+const char* const checkpoint_path = "/tmp/BenchDeque_checkpoint.bin";
+
+void BM_checkpoint_stream (benchmark::State& state) {
+    my_deque<value_type> x;
+    value_type r = 0;
+    x.append_n(1 << 22, [&] () {return r++;});
+    for (auto _ : state) {
+        {
+        std::ofstream out(checkpoint_path, std::ios::binary);
+        for (my_deque<value_type>::const_iterator b = x.begin(), e = x.end(); b != e; ++b)
+            out.write(reinterpret_cast<const char*>(&*b), sizeof(value_type));
+        }
+        std::ifstream in(checkpoint_path, std::ios::binary);
+        my_deque<value_type> y;
+        value_type v;
+        while (in.read(reinterpret_cast<char*>(&v), sizeof(v)))
+            y.push_back(v);
+        benchmark::DoNotOptimize(y.size());}
+    std::remove(checkpoint_path);
+    state.SetBytesProcessed(state.iterations() * 2 * x.size() * sizeof(value_type));}
+
+void BM_checkpoint_vectored (benchmark::State& state) {
+    my_deque<value_type> x;
+    value_type r = 0;
+    x.append_n(1 << 22, [&] () {return r++;});
+    for (auto _ : state) {
+        const int fd = ::open(checkpoint_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        write_deque(fd, x);
+        ::lseek(fd, 0, SEEK_SET);
+        my_deque<value_type> y;
+        read_deque(fd, y);
+        ::close(fd);
+        benchmark::DoNotOptimize(y.size());}
+    std::remove(checkpoint_path);
+    state.SetBytesProcessed(state.iterations() * 2 * x.size() * sizeof(value_type));}
+
+BENCHMARK(BM_checkpoint_stream)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_checkpoint_vectored)->Unit(benchmark::kMillisecond);
+
+// --------------
+// BM_short_lived
+// --------------
+
+// a deque per request: made, given range(0) elements, drained and destroyed,
+// a million times per iteration; 32 is past small_deque's 16 inline slots
+
+template <typename D>
+void BM_short_lived (benchmark::State& state) {
+    const std::size_t n = state.range(0);
+    for (auto _ : state)
+        for (int k = 0; k != 1000000; ++k) {
+            D x;
+            for (std::size_t i = 0; i != n; ++i)
+                x.push_back(i);
+            while (!x.empty())
+                x.pop_front();
+            benchmark::DoNotOptimize(x);}
+    state.SetItemsProcessed(state.iterations() * 1000000);}
+
+BENCHMARK_TEMPLATE(BM_short_lived, std::deque<value_type>)->Arg(4)->Arg(12)->Arg(32)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_short_lived, my_deque<value_type>)->Arg(4)->Arg(12)->Arg(32)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_short_lived, small_deque<value_type, 16>)->Arg(4)->Arg(12)->Arg(32)->Unit(benchmark::kMillisecond);
+
+// ----------
+// BM_latency
+// ----------
+
+// per-operation push and pop latency, timed one operation at a time, over
+// bursts of up to 4096 pushes at the back and pops at the front: a
+// my_deque, which drops and reallocates blocks as it shrinks and grows,
+// against a bounded_deque that has all of its blocks from the start
+
+template <typename D, typename P>
+void latency (benchmark::State& state, D& x, P push) {
+    typedef std::chrono::steady_clock clock;
+    std::vector<double> t;
+    t.reserve(1 << 21);
+    unsigned r = 1;
+    for (auto _ : state) {
+        t.clear();
+        while (t.size() < (1 << 20)) {
+            r = (r * 1103515245u) + 12345u;
+            const std::size_t n = (r >> 16) % 4096;
+            for (std::size_t i = 0; i != n; ++i) {
+                const clock::time_point b = clock::now();
+                push(x, i);
+                t.push_back(std::chrono::duration<double, std::nano>(clock::now() - b).count());}
+            while (!x.empty()) {
+                const clock::time_point b = clock::now();
+                x.pop_front();
+                t.push_back(std::chrono::duration<double, std::nano>(clock::now() - b).count());}}}
+    std::sort(t.begin(), t.end());
+    state.counters["p50_ns"]   = t[t.size() / 2];
+    state.counters["p99_ns"]   = t[(t.size() * 99) / 100];
+    state.counters["p99.9_ns"] = t[(t.size() * 999) / 1000];
+    state.counters["max_ns"]   = t.back();}
+
+void BM_latency_growable (benchmark::State& state) {
+    my_deque<value_type> x;
+    latency(state, x, [] (my_deque<value_type>& y, value_type v) {
+        y.push_back(v);});}
+
+void BM_latency_bounded (benchmark::State& state) {
+    bounded_deque<value_type> x(4096);
+    latency(state, x, [] (bounded_deque<value_type>& y, value_type v) {
+        y.try_push_back(v);});}
+
+BENCHMARK(BM_latency_growable)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_latency_bounded)->Unit(benchmark::kMillisecond);
+
+// -----------
+// BM_snapshot
+// -----------
+
+// a read-only copy of 2^24 ints for another thread: a my_deque copy
+// against a cow_deque snapshot, which shares the blocks
+
+void BM_snapshot_copy (benchmark::State& state) {
+    my_deque<int> x(1 << 24, 1);
+    for (auto _ : state) {
+        my_deque<int> y(x);
+        benchmark::DoNotOptimize(y.size());}}
+
+void BM_snapshot_cow (benchmark::State& state) {
+    cow_deque<int> x;
+    for (int i = 0; i != (1 << 24); ++i)
+        x.push_back(i);
+    for (auto _ : state) {
+        cow_deque<int> y = x.snapshot();
+        benchmark::DoNotOptimize(y.size());}}
+
+BENCHMARK(BM_snapshot_copy)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_snapshot_cow)->Unit(benchmark::kMicrosecond);
+
+// ---------
+// BM_stream
+// ---------
+
+// one front-to-back pass over 512 MiB of 64-bit ints with the segmented
+// accumulate, prefetching 0, 1, 2 or 4 blocks ahead; the blocks are
+// allocated between other allocations, as in a deque that grew slowly
+
+template <std::size_t D>
+struct stream_value {
+    value_type v;};
+
+template <std::size_t D>
+struct my_deque_prefetch_distance<stream_value<D> > {
+    static const std::size_t value = D;};
+
+template <std::size_t D>
+void BM_stream (benchmark::State& state) {
+    typedef stream_value<D> T;
+    my_deque<T> x;
+    std::vector<std::vector<char> > noise;
+    const std::size_t n = std::size_t(1) << 26;
+    for (std::size_t i = 0; i != n; ++i) {
+        const T v = {i};
+        x.push_back(v);
+        if ((i % 512) == 0)
+            noise.push_back(std::vector<char>(1 + ((i * 2654435761u) % 8192)));}
+    const my_deque<T>& y = x;
+    for (auto _ : state)
+        benchmark::DoNotOptimize(accumulate(y.begin(), y.end(), value_type(0), [] (value_type s, const T& t) {return s + t.v;}));
+    state.SetBytesProcessed(state.iterations() * n * sizeof(T));}
+
+BENCHMARK_TEMPLATE(BM_stream, 0)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_stream, 1)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_stream, 2)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_stream, 4)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
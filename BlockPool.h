@@ -0,0 +1,494 @@
+// --------------------------
+// projects/deque/BlockPool.h
+// Copyright (C) 2014
+// Glenn P. Downing
+// --------------------------
+
+#ifndef BlockPool_h
+#define BlockPool_h
+
+// --------
+// includes
+// --------
+
+#include <algorithm> // max, min
+#include <cstddef>   // ptrdiff_t, size_t
+#include <memory>    // shared_ptr, unique_ptr
+#include <mutex>     // lock_guard, mutex
+#include <new>       // bad_alloc, operator delete, operator new
+#include <type_traits> // true_type
+#include <utility>   // forward
+#include <vector>    // vector
+
+#include "Deque.h"
+
+class block_pool;
+
+// -----------
+// block_arena
+// -----------
+
+/**
+ * Thread-safe free list of blocks of one fixed size, shared by any number
+ * of deques and threads. Freed blocks are kept for the next allocate
+ * instead of going back to operator delete; they are released when the
+ * arena and every thread cache drawing from it are gone.
+ */
+class block_arena {
+    friend class block_pool;
+
+    private:
+        // -----
+        // state
+        // -----
+
+        /**
+         * The free list proper. Thread caches hold on to it, so it
+         * outlives the arena object if a thread still caches its blocks.
+         */
+        struct state {
+            const std::size_t bytes;
+            std::mutex        m;
+            void*             free;
+            std::size_t       count;
+
+            explicit state (std::size_t b) :
+                    bytes (b),
+                    free  (0),
+                    count (0)
+                {}
+
+            ~state () {
+                while (free) {
+                    void* const p = free;
+                    free = *static_cast<void**>(p);
+                    ::operator delete(p);}}
+
+            /**
+             * Unlinks up to n blocks and returns the chain; n is set to
+             * the number taken.
+             */
+            void* take (std::size_t& n) {
+                std::lock_guard<std::mutex> lock(m);
+                n = std::min(n, count);
+                void* const h = free;
+                void*       p = free;
+                for (std::size_t i = 1; i < n; ++i)
+                    p = *static_cast<void**>(p);
+                if (n != 0) {
+                    free = *static_cast<void**>(p);
+                    *static_cast<void**>(p) = 0;}
+                count -= n;
+                return n ? h : 0;}
+
+            /**
+             * Links the chain h..t of n blocks in front of the free list.
+             */
+            void give (void* h, void* t, std::size_t n) {
+                if (n == 0)
+                    return;
+                std::lock_guard<std::mutex> lock(m);
+                *static_cast<void**>(t) = free;
+                free = h;
+                count += n;}};
+
+        std::shared_ptr<state> _s;
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * An arena for blocks of the given size in bytes.
+         */
+        explicit block_arena (std::size_t bytes) :
+                _s (std::make_shared<state>(bytes))
+            {}
+
+        block_arena             (const block_arena&) = delete;
+        block_arena& operator = (const block_arena&) = delete;
+
+        // --------
+        // allocate
+        // --------
+
+        /**
+         * Returns a free block, or a new one if there is none.
+         */
+        void* allocate () {
+            std::size_t n = 1;
+            if (void* const p = _s->take(n))
+                return p;
+            return ::operator new(std::max(_s->bytes, sizeof(void*)));}
+
+        // ----------
+        // deallocate
+        // ----------
+
+        /**
+         * Puts p on the free list.
+         */
+        void deallocate (void* p) {
+            _s->give(p, p, 1);}
+
+        // -----
+        // bytes
+        // -----
+
+        /**
+         * Size of the blocks this arena hands out.
+         */
+        std::size_t bytes () const {
+            return _s->bytes;}
+
+        // ------
+        // cached
+        // ------
+
+        /**
+         * Number of free blocks in the shared list, not counting the ones
+         * held by thread caches.
+         */
+        std::size_t cached () const {
+            std::lock_guard<std::mutex> lock(_s->m);
+            return _s->count;}
+
+        // -----
+        // local
+        // -----
+
+        /**
+         * The calling thread's cache in front of this arena, made on
+         * first use.
+         */
+        block_pool& local ();};
+
+// ----------
+// block_pool
+// ----------
+
+/**
+ * Free list of blocks of one fixed size for use by a single thread, so
+ * allocate and deallocate take no lock. Backed by an arena it refills
+ * from it and spills back to it in batches of half its capacity;
+ * otherwise surplus blocks go to operator delete.
+ */
+class block_pool {
+    friend class block_arena;
+
+    private:
+        // ----
+        // data
+        // ----
+
+        std::shared_ptr<block_arena::state> _r;
+        std::size_t _bytes;
+        std::size_t _capacity;
+        void*       _free;
+        std::size_t _count;
+
+        // -----
+        // spill
+        // -----
+
+        /**
+         * Hands the first n cached blocks to the arena, or frees them.
+         */
+        void spill (std::size_t n) {
+            void* const h = _free;
+            void*       t = _free;
+            for (std::size_t i = 1; i < n; ++i)
+                t = *static_cast<void**>(t);
+            _free   = *static_cast<void**>(t);
+            _count -= n;
+            if (_r)
+                _r->give(h, t, n);
+            else {
+                void* p = h;
+                for (std::size_t i = 0; i != n; ++i) {
+                    void* const q = p;
+                    p = *static_cast<void**>(p);
+                    ::operator delete(q);}}}
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * A pool for blocks of the given size in bytes, keeping at most
+         * capacity free blocks.
+         */
+        explicit block_pool (std::size_t bytes, std::size_t capacity = 64) :
+                _bytes    (bytes),
+                _capacity (std::max<std::size_t>(capacity, 2)),
+                _free     (0),
+                _count    (0)
+            {}
+
+        /**
+         * A pool in front of r, for r's block size.
+         */
+        explicit block_pool (block_arena& r, std::size_t capacity = 64) :
+                _r        (r._s),
+                _bytes    (r.bytes()),
+                _capacity (std::max<std::size_t>(capacity, 2)),
+                _free     (0),
+                _count    (0)
+            {}
+
+        block_pool             (const block_pool&) = delete;
+        block_pool& operator = (const block_pool&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+        ~block_pool () {
+            if (_count != 0)
+                spill(_count);}
+
+        // --------
+        // allocate
+        // --------
+
+        /**
+         * Returns a cached block, refilling from the arena or falling back
+         * to operator new when the cache is empty.
+         */
+        void* allocate () {
+            if (!_free && _r) {
+                std::size_t n = _capacity / 2;
+                _free  = _r->take(n);
+                _count = n;}
+            if (void* const p = _free) {
+                _free = *static_cast<void**>(p);
+                --_count;
+                return p;}
+            return ::operator new(std::max(_bytes, sizeof(void*)));}
+
+        // ----------
+        // deallocate
+        // ----------
+
+        /**
+         * Caches p, spilling half the cache once it is over capacity.
+         */
+        void deallocate (void* p) {
+            *static_cast<void**>(p) = _free;
+            _free = p;
+            if (++_count > _capacity)
+                spill(_capacity / 2);}
+
+        // -----
+        // bytes
+        // -----
+
+        /**
+         * Size of the blocks this pool hands out.
+         */
+        std::size_t bytes () const {
+            return _bytes;}
+
+        // ------
+        // cached
+        // ------
+
+        /**
+         * Number of free blocks held by this pool.
+         */
+        std::size_t cached () const {
+            return _count;}};
+
+// -----
+// local
+// -----
+
+inline block_pool& block_arena::local () {
+    typedef std::vector< std::unique_ptr<block_pool> > caches;
+    static thread_local caches c;
+    for (std::size_t i = 0; i != c.size(); ++i)
+        if (c[i]->_r == _s)
+            return *c[i];
+    // drop the caches of arenas that no longer exist; that frees their blocks
+    for (std::size_t i = 0; i != c.size();)
+        if (c[i]->_r.use_count() == 1) {
+            c[i].swap(c.back());
+            c.pop_back();}
+        else
+            ++i;
+    c.push_back(std::unique_ptr<block_pool>(new block_pool(*this)));
+    return *c.back();}
+
+// --------------------
+// block_pool_allocator
+// --------------------
+
+/**
+ * Allocator that serves requests of exactly one pool block from a
+ * block_pool, or from the calling thread's cache of a block_arena, and
+ * everything else (the map, other block sizes) from operator new. A
+ * default-constructed one always uses operator new. All storage comes
+ * from operator new in the end, so any two of these allocators may free
+ * each other's memory and compare equal. A block_pool is not
+ * thread-safe: a deque whose allocator names a pool must stay on that
+ * pool's thread; bind to an arena to share blocks between threads.
+ */
+template <typename T>
+class block_pool_allocator {
+    template <typename U>
+    friend class block_pool_allocator;
+
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef T                 value_type;
+
+        typedef std::size_t       size_type;
+        typedef std::ptrdiff_t    difference_type;
+
+        typedef value_type*       pointer;
+        typedef const value_type* const_pointer;
+
+        typedef value_type&       reference;
+        typedef const value_type& const_reference;
+
+        template <typename U>
+        struct rebind {
+            typedef block_pool_allocator<U> other;};
+
+    public:
+        // -----------
+        // operator ==
+        // -----------
+
+        friend bool operator == (const block_pool_allocator&, const block_pool_allocator&) {
+            return true;}
+
+        friend bool operator != (const block_pool_allocator& lhs, const block_pool_allocator& rhs) {
+            return !(lhs == rhs);}
+
+    private:
+        // ----
+        // data
+        // ----
+
+        block_pool*  _p;
+        block_arena* _r;
+
+        // ----
+        // pool
+        // ----
+
+        /**
+         * The pool that serves requests of the given size, if any.
+         */
+        block_pool* pool (std::size_t bytes) const {
+            if (_p && (_p->bytes() == bytes))
+                return _p;
+            if (_r && (_r->bytes() == bytes))
+                return &_r->local();
+            return 0;}
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        block_pool_allocator () noexcept :
+                _p (0),
+                _r (0)
+            {}
+
+        /**
+         * Serves blocks from p; p must outlive the allocator and its copies.
+         */
+        explicit block_pool_allocator (block_pool& p) noexcept :
+                _p (&p),
+                _r (0)
+            {}
+
+        /**
+         * Serves blocks from r through per-thread caches; r must outlive
+         * the allocator and its copies.
+         */
+        explicit block_pool_allocator (block_arena& r) noexcept :
+                _p (0),
+                _r (&r)
+            {}
+
+        template <typename U>
+        block_pool_allocator (const block_pool_allocator<U>& that) noexcept :
+                _p (that._p),
+                _r (that._r)
+            {}
+
+        // --------
+        // allocate
+        // --------
+
+        pointer allocate (size_type n) {
+            if (n > max_size())
+                throw std::bad_alloc();
+            if (block_pool* const p = pool(n * sizeof(T)))
+                return static_cast<pointer>(p->allocate());
+            return static_cast<pointer>(::operator new(n * sizeof(T)));}
+
+        // ----------
+        // deallocate
+        // ----------
+
+        void deallocate (pointer q, size_type n) {
+            if (block_pool* const p = pool(n * sizeof(T)))
+                p->deallocate(q);
+            else
+                ::operator delete(q);}
+
+        // ---------
+        // construct
+        // ---------
+
+        template <typename U, typename... Args>
+        void construct (U* p, Args&&... args) {
+            ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);}
+
+        // -------
+        // destroy
+        // -------
+
+        template <typename U>
+        void destroy (U* p) {
+            p->~U();}
+
+        // --------
+        // max_size
+        // --------
+
+        size_type max_size () const {
+            return size_type(-1) / sizeof(T);}};
+
+// --------------------------
+// my_deque_trivial_allocator
+// --------------------------
+
+/**
+ * construct and destroy are plain placement new and ~T().
+ */
+template <typename T>
+struct my_deque_trivial_allocator< block_pool_allocator<T> > : std::true_type {};
+
+// -----------
+// block_bytes
+// -----------
+
+/**
+ * Size in bytes of D's blocks, for sizing a block_pool or block_arena.
+ */
+template <typename D>
+struct block_bytes {
+    static const std::size_t value = D::block_size * sizeof(typename D::value_type);};
+
+#endif // BlockPool_h
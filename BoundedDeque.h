@@ -0,0 +1,323 @@
+// -----------------------------
+// projects/deque/BoundedDeque.h
+// Copyright (C) 2014
+// Glenn P. Downing
+// -----------------------------
+
+#ifndef BoundedDeque_h
+#define BoundedDeque_h
+
+// --------
+// includes
+// --------
+
+#include <algorithm> // max
+#include <cassert>   // assert
+#include <cstddef>   // size_t
+#include <memory>    // allocator, allocator_traits
+#include <stdexcept> // out_of_range
+#include <utility>   // forward, move
+
+#include "Deque.h"
+
+// ----------------------
+// bounded_deque_overflow
+// ----------------------
+
+/**
+ * What a push into a full bounded_deque does: fail, or make room by
+ * dropping the element at the other end, the oldest one for a queue.
+ */
+enum bounded_deque_overflow {
+    bounded_deque_reject,
+    bounded_deque_overwrite};
+
+// -------------
+// bounded_deque
+// -------------
+
+/**
+ * Deque of at most capacity elements that allocates only in its
+ * constructor, for paths where a push must never reach the allocator.
+ * The blocks of B elements are all allocated up front and their map is
+ * a ring: the front and back wrap around it, so the live elements are
+ * the capacity slots from the front on, modulo the blocks' slots. Pushes
+ * and pops at either end are a few adds and compares, and never move an
+ * element, so references stay valid until their element is popped or
+ * overwritten.
+ */
+template < typename T, typename A = std::allocator<T>, std::size_t B = my_deque_block_size<T>::value >
+class bounded_deque {
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef A                                        allocator_type;
+        typedef typename allocator_type::value_type      value_type;
+
+        typedef typename allocator_type::size_type       size_type;
+        typedef typename allocator_type::difference_type difference_type;
+
+        typedef typename allocator_type::pointer         pointer;
+        typedef typename allocator_type::const_pointer   const_pointer;
+
+        typedef typename allocator_type::reference       reference;
+        typedef typename allocator_type::const_reference const_reference;
+
+        typedef typename std::allocator_traits<A>::template rebind_alloc<pointer> map_allocator_type;
+
+        // ---------
+        // constants
+        // ---------
+
+        static const size_type block_size = B;
+
+        static_assert(B > 0, "bounded_deque block size must be positive");
+
+    private:
+        // ----
+        // data
+        // ----
+
+        allocator_type         _a;
+        map_allocator_type     _pa;
+        pointer*               _map;        // _blocks block pointers
+        size_type              _blocks;
+        size_type              _slots;      // _blocks * B
+        size_type              _capacity;
+        size_type              _front;      // ring slot of the front
+        size_type              _size;
+        bounded_deque_overflow _overflow;
+
+        // -----
+        // valid
+        // -----
+
+        bool valid () const {
+            return (_capacity <= _slots) && (_size <= _capacity) && ((_front < _slots) || !_slots);}
+
+        // ----
+        // slot
+        // ----
+
+        /**
+         * Ring slot k, for k < 2 * _slots.
+         */
+        pointer slot (size_type k) const {
+            if (k >= _slots)
+                k -= _slots;
+            return _map[k / B] + (k % B);}
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * Allocates the blocks for capacity elements; all the allocation
+         * the deque will ever do.
+         */
+        explicit bounded_deque (size_type capacity, bounded_deque_overflow overflow = bounded_deque_reject, const allocator_type& a = allocator_type()) :
+                _a        (a),
+                _pa       (_a),
+                _map      (0),
+                _blocks   ((capacity + B - 1) / B),
+                _slots    (_blocks * B),
+                _capacity (capacity),
+                _front    (0),
+                _size     (0),
+                _overflow (overflow) {
+            _map = _pa.allocate(std::max<size_type>(_blocks, 1));
+            size_type i = 0;
+            try {
+                for (; i != _blocks; ++i)
+                    _map[i] = _a.allocate(B);}
+            catch (...) {
+                while (i != 0)
+                    _a.deallocate(_map[--i], B);
+                _pa.deallocate(_map, std::max<size_type>(_blocks, 1));
+                throw;}
+            assert(valid());}
+
+        bounded_deque             (const bounded_deque&) = delete;
+        bounded_deque& operator = (const bounded_deque&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+        ~bounded_deque () {
+            clear();
+            for (size_type i = 0; i != _blocks; ++i)
+                _a.deallocate(_map[i], B);
+            _pa.deallocate(_map, std::max<size_type>(_blocks, 1));}
+
+        // -----------
+        // operator []
+        // -----------
+
+        reference operator [] (size_type i) {
+            return *slot(_front + i);}
+
+        const_reference operator [] (size_type i) const {
+            return const_cast<bounded_deque*>(this)->operator[](i);}
+
+        // --
+        // at
+        // --
+
+        reference at (size_type i) {
+            if (i >= size())
+                throw std::out_of_range("bounded_deque");
+            return (*this)[i];}
+
+        const_reference at (size_type i) const {
+            return const_cast<bounded_deque*>(this)->at(i);}
+
+        // ----
+        // back
+        // ----
+
+        reference back () {
+            assert(!empty());
+            return (*this)[_size - 1];}
+
+        const_reference back () const {
+            return const_cast<bounded_deque*>(this)->back();}
+
+        // --------
+        // capacity
+        // --------
+
+        size_type capacity () const {
+            return _capacity;}
+
+        // -----
+        // clear
+        // -----
+
+        void clear () {
+            while (!empty())
+                pop_back();}
+
+        // -----
+        // empty
+        // -----
+
+        bool empty () const {
+            return _size == 0;}
+
+        // -----
+        // front
+        // -----
+
+        reference front () {
+            assert(!empty());
+            return (*this)[0];}
+
+        const_reference front () const {
+            return const_cast<bounded_deque*>(this)->front();}
+
+        // ----
+        // full
+        // ----
+
+        bool full () const {
+            return _size == _capacity;}
+
+        // --------
+        // overflow
+        // --------
+
+        bounded_deque_overflow overflow () const {
+            return _overflow;}
+
+        // ---
+        // pop
+        // ---
+
+        void pop_back () {
+            assert(!empty());
+            --_size;
+            _a.destroy(slot(_front + _size));
+            assert(valid());}
+
+        void pop_front () {
+            assert(!empty());
+            _a.destroy(slot(_front));
+            if (++_front == _slots)
+                _front = 0;
+            --_size;
+            assert(valid());}
+
+        // ----
+        // size
+        // ----
+
+        size_type size () const {
+            return _size;}
+
+        // ----------------
+        // try_emplace_back
+        // ----------------
+
+        /**
+         * Constructs a new back element in place from args. If the deque
+         * is full, returns false or drops the front to make room, as
+         * overflow says.
+         */
+        template <typename... Args>
+        bool try_emplace_back (Args&&... args) {
+            if (full()) {
+                if ((_overflow == bounded_deque_reject) || (_capacity == 0))
+                    return false;
+                value_type v(std::forward<Args>(args)...); // args may refer to the front
+                pop_front();
+                return try_emplace_back(std::move(v));}
+            _a.construct(slot(_front + _size), std::forward<Args>(args)...);
+            ++_size;
+            assert(valid());
+            return true;}
+
+        // -----------------
+        // try_emplace_front
+        // -----------------
+
+        /**
+         * Constructs a new front element in place from args. If the deque
+         * is full, returns false or drops the back to make room, as
+         * overflow says.
+         */
+        template <typename... Args>
+        bool try_emplace_front (Args&&... args) {
+            if (full()) {
+                if ((_overflow == bounded_deque_reject) || (_capacity == 0))
+                    return false;
+                value_type v(std::forward<Args>(args)...); // args may refer to the back
+                pop_back();
+                return try_emplace_front(std::move(v));}
+            const size_type f = (_front == 0) ? (_slots - 1) : (_front - 1);
+            _a.construct(slot(f), std::forward<Args>(args)...);
+            _front = f;
+            ++_size;
+            assert(valid());
+            return true;}
+
+        // --------
+        // try_push
+        // --------
+
+        bool try_push_back (const_reference v) {
+            return try_emplace_back(v);}
+
+        bool try_push_back (value_type&& v) {
+            return try_emplace_back(std::move(v));}
+
+        bool try_push_front (const_reference v) {
+            return try_emplace_front(v);}
+
+        bool try_push_front (value_type&& v) {
+            return try_emplace_front(std::move(v));}};
+
+#endif // BoundedDeque_h
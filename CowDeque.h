@@ -0,0 +1,486 @@
+// -------------------------
+// projects/deque/CowDeque.h
+// Copyright (C) 2014
+// Glenn P. Downing
+// -------------------------
+
+#ifndef CowDeque_h
+#define CowDeque_h
+
+// --------
+// includes
+// --------
+
+#include <algorithm>   // min
+#include <atomic>      // atomic, memory_order_acq_rel, memory_order_acquire, memory_order_relaxed
+#include <cassert>     // assert
+#include <cstddef>     // size_t
+#include <memory>      // allocator, allocator_traits
+#include <stdexcept>   // out_of_range
+#include <type_traits> // aligned_storage, alignment_of
+#include <utility>     // forward, move, swap
+
+#include "Deque.h"
+
+// ---------
+// cow_deque
+// ---------
+
+/**
+ * Deque whose copies share blocks: a copy (or snapshot()) takes a
+ * reference to each of the source's blocks instead of copying elements,
+ * so it costs O(number of blocks), and a block is copied only when one
+ * of the deques sharing it writes to it. Blocks that neither side
+ * touches stay physically shared for as long as both live.
+ *
+ * Elements live in blocks of B, reached through a my_deque of block
+ * pointers, as in my_deque. A block counts its owners and records which
+ * of its slots hold constructed elements. A pop from a shared block only
+ * narrows the popping deque's view and leaves the element to the block's
+ * last owner, which destroys whatever is still constructed in it.
+ *
+ * Reference counts are atomic, so a snapshot may be handed to another
+ * thread (a reporting thread, say) while the original keeps changing;
+ * each deque itself is used by one thread at a time. The non-const
+ * accessors copy a shared block before returning a reference into it.
+ */
+template < typename T, typename A = std::allocator<T>, std::size_t B = my_deque_block_size<T>::value >
+class cow_deque {
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef A                                        allocator_type;
+        typedef typename allocator_type::value_type      value_type;
+
+        typedef typename allocator_type::size_type       size_type;
+        typedef typename allocator_type::difference_type difference_type;
+
+        typedef typename allocator_type::pointer         pointer;
+        typedef typename allocator_type::const_pointer   const_pointer;
+
+        typedef typename allocator_type::reference       reference;
+        typedef typename allocator_type::const_reference const_reference;
+
+        // ---------
+        // constants
+        // ---------
+
+        static const size_type block_size = B;
+
+        static_assert(B > 0, "cow_deque block size must be positive");
+
+    private:
+        // -----
+        // block
+        // -----
+
+        /**
+         * B slots of raw storage, the number of deques sharing them, and
+         * the slots [lo, hi) that hold constructed elements. lo and hi
+         * change only while the block has a single owner.
+         */
+        struct block {
+            std::atomic<size_type> refs;
+            size_type              lo;
+            size_type              hi;
+            typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type slots[B];
+
+            pointer slot (size_type i) {
+                return reinterpret_cast<pointer>(&slots[i]);}};
+
+        typedef typename std::allocator_traits<A>::template rebind_alloc<block>  block_allocator_type;
+        typedef typename std::allocator_traits<A>::template rebind_alloc<block*> map_allocator_type;
+
+        // ----
+        // data
+        // ----
+
+        allocator_type                         _a;
+        block_allocator_type                   _ba;
+        my_deque<block*, map_allocator_type>   _map;
+        size_type                              _front;  // slot of the front in _map.front()
+        size_type                              _size;
+
+        // -----
+        // valid
+        // -----
+
+        bool valid () const {
+            return (_front < B) && (_map.size() == (_size ? ((_front + _size + B - 1) / B) : 0));}
+
+        // ---------
+        // new_block
+        // ---------
+
+        block* new_block (size_type lo) {
+            block* const b = _ba.allocate(1);
+            b->refs.store(1, std::memory_order_relaxed);
+            b->lo = b->hi = lo;
+            return b;}
+
+        // -------------
+        // release_block
+        // -------------
+
+        /**
+         * Drops one reference to b; the last owner destroys what is still
+         * constructed in it and frees it.
+         */
+        void release_block (block* b) {
+            if (b->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                return;
+            for (size_type i = b->lo; i != b->hi; ++i)
+                _a.destroy(b->slot(i));
+            _ba.deallocate(b, 1);}
+
+        // ----
+        // view
+        // ----
+
+        /**
+         * The slots of block j that this deque sees.
+         */
+        size_type view_lo (size_type j) const {
+            return (j == 0) ? _front : 0;}
+
+        size_type view_hi (size_type j) const {
+            return std::min(B, _front + _size - (j * B));}
+
+        // ---------
+        // exclusive
+        // ---------
+
+        /**
+         * Makes block j this deque's alone, with exactly the slots this
+         * deque sees constructed, and returns it: a shared block is
+         * copied, those slots only; one this deque already owns alone has
+         * the elements other owners popped while it was shared destroyed.
+         */
+        block* exclusive (size_type j) {
+            const size_type lo = view_lo(j);
+            const size_type hi = view_hi(j);
+            block* b = _map[j];
+            if (b->refs.load(std::memory_order_acquire) != 1) {
+                block* const c = new_block(lo);
+                try {
+                    for (; c->hi != hi; ++c->hi)
+                        _a.construct(c->slot(c->hi), *b->slot(c->hi));}
+                catch (...) {
+                    release_block(c);
+                    throw;}
+                release_block(b);
+                _map[j] = b = c;}
+            else {
+                for (; b->lo < lo; ++b->lo)
+                    _a.destroy(b->slot(b->lo));
+                for (; b->hi > hi; --b->hi)
+                    _a.destroy(b->slot(b->hi - 1));}
+            return b;}
+
+        // ---------
+        // share_all
+        // ---------
+
+        void share_all () {
+            for (size_type j = 0; j != _map.size(); ++j)
+                _map[j]->refs.fetch_add(1, std::memory_order_relaxed);}
+
+        // -----------
+        // release_all
+        // -----------
+
+        void release_all () {
+            for (size_type j = 0; j != _map.size(); ++j)
+                release_block(_map[j]);
+            _map.clear();
+            _front = _size = 0;}
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        explicit cow_deque (const allocator_type& a = allocator_type()) :
+                _a     (a),
+                _ba    (_a),
+                _map   (map_allocator_type(_a)),
+                _front (0),
+                _size  (0) {
+            assert(valid());}
+
+        /**
+         * Shares that's blocks: O(number of blocks), no element copied.
+         */
+        cow_deque (const cow_deque& that) :
+                _a     (that._a),
+                _ba    (that._ba),
+                _map   (that._map),
+                _front (that._front),
+                _size  (that._size) {
+            share_all();
+            assert(valid());}
+
+        /**
+         * Takes over that's blocks; that is left empty.
+         */
+        cow_deque (cow_deque&& that) :
+                _a     (that._a),
+                _ba    (that._ba),
+                _map   (std::move(that._map)),
+                _front (that._front),
+                _size  (that._size) {
+            that._front = that._size = 0;
+            assert(valid());}
+
+        // ----------
+        // destructor
+        // ----------
+
+        ~cow_deque () {
+            release_all();}
+
+        // ----------
+        // operator =
+        // ----------
+
+        cow_deque& operator = (const cow_deque& rhs) {
+            cow_deque x(rhs);
+            swap(x);
+            return *this;}
+
+        cow_deque& operator = (cow_deque&& rhs) {
+            cow_deque x(std::move(rhs));
+            swap(x);
+            return *this;}
+
+        // -----------
+        // operator []
+        // -----------
+
+        /**
+         * Copies the element's block first if it is shared.
+         */
+        reference operator [] (size_type i) {
+            const size_type k = _front + i;
+            return *exclusive(k / B)->slot(k % B);}
+
+        const_reference operator [] (size_type i) const {
+            const size_type k = _front + i;
+            return *_map[k / B]->slot(k % B);}
+
+        // --
+        // at
+        // --
+
+        reference at (size_type i) {
+            if (i >= size())
+                throw std::out_of_range("cow_deque");
+            return (*this)[i];}
+
+        const_reference at (size_type i) const {
+            if (i >= size())
+                throw std::out_of_range("cow_deque");
+            return (*this)[i];}
+
+        // ----
+        // back
+        // ----
+
+        reference back () {
+            assert(!empty());
+            return (*this)[_size - 1];}
+
+        const_reference back () const {
+            assert(!empty());
+            return (*this)[_size - 1];}
+
+        // -------
+        // emplace
+        // -------
+
+        /**
+         * Constructs a new back element in place from args, copying the
+         * back block first if it is shared.
+         */
+        template <typename... Args>
+        void emplace_back (Args&&... args) {
+            const size_type e = _front + _size;
+            const size_type s = e % B;
+            if (s == 0) {
+                _map.reserve_back(1);
+                block* const b = new_block(0);
+                try {
+                    _a.construct(b->slot(0), std::forward<Args>(args)...);}
+                catch (...) {
+                    _ba.deallocate(b, 1);
+                    throw;}
+                b->hi = 1;
+                _map.push_back(b);}
+            else {
+                block* const b = exclusive(e / B);
+                _a.construct(b->slot(s), std::forward<Args>(args)...);
+                b->hi = s + 1;}
+            ++_size;
+            assert(valid());}
+
+        /**
+         * Constructs a new front element in place from args, copying the
+         * front block first if it is shared.
+         */
+        template <typename... Args>
+        void emplace_front (Args&&... args) {
+            if (_front == 0) {
+                _map.reserve_front(1);
+                block* const b = new_block(B - 1);
+                try {
+                    _a.construct(b->slot(B - 1), std::forward<Args>(args)...);}
+                catch (...) {
+                    _ba.deallocate(b, 1);
+                    throw;}
+                b->hi = B;
+                _map.push_front(b);
+                _front = B - 1;}
+            else {
+                block* const b = exclusive(0);
+                _a.construct(b->slot(_front - 1), std::forward<Args>(args)...);
+                b->lo = --_front;}
+            ++_size;
+            assert(valid());}
+
+        // -----
+        // empty
+        // -----
+
+        bool empty () const {
+            return _size == 0;}
+
+        // --------------
+        // for_each_block
+        // --------------
+
+        /**
+         * Calls f(p, n) for each run of n contiguous elements at p, front
+         * to back; the way for a reader to scan a snapshot at memory speed.
+         */
+        template <typename F>
+        void for_each_block (F f) const {
+            for (size_type j = 0; j != _map.size(); ++j) {
+                const const_pointer p = _map[j]->slot(view_lo(j));
+                f(p, view_hi(j) - view_lo(j));}}
+
+        // -----
+        // front
+        // -----
+
+        reference front () {
+            assert(!empty());
+            return (*this)[0];}
+
+        const_reference front () const {
+            assert(!empty());
+            return (*this)[0];}
+
+        // ---
+        // pop
+        // ---
+
+        /**
+         * Destroys the back element, or, if its block is shared, leaves it
+         * to the block's last owner.
+         */
+        void pop_back () {
+            assert(!empty());
+            const size_type e = _front + _size - 1;
+            block* const b = _map[e / B];
+            if (b->refs.load(std::memory_order_acquire) == 1) {
+                exclusive(e / B);
+                _a.destroy(b->slot(e % B));
+                b->hi = e % B;}
+            if (--_size == 0)
+                release_all();
+            else if ((e % B) == 0) {
+                release_block(b);
+                _map.pop_back();}
+            assert(valid());}
+
+        /**
+         * Destroys the front element, or, if its block is shared, leaves
+         * it to the block's last owner.
+         */
+        void pop_front () {
+            assert(!empty());
+            block* const b = _map.front();
+            if (b->refs.load(std::memory_order_acquire) == 1) {
+                exclusive(0);
+                _a.destroy(b->slot(_front));
+                b->lo = _front + 1;}
+            if (--_size == 0)
+                release_all();
+            else if (++_front == B) {
+                release_block(b);
+                _map.pop_front();
+                _front = 0;}
+            assert(valid());}
+
+        // ----
+        // push
+        // ----
+
+        void push_back (const_reference v) {
+            emplace_back(v);}
+
+        void push_back (value_type&& v) {
+            emplace_back(std::move(v));}
+
+        void push_front (const_reference v) {
+            emplace_front(v);}
+
+        void push_front (value_type&& v) {
+            emplace_front(std::move(v));}
+
+        // -------------
+        // shared_blocks
+        // -------------
+
+        /**
+         * Number of this deque's blocks that some other deque shares.
+         */
+        size_type shared_blocks () const {
+            size_type n = 0;
+            for (size_type j = 0; j != _map.size(); ++j)
+                n += (_map[j]->refs.load(std::memory_order_acquire) != 1);
+            return n;}
+
+        // ----
+        // size
+        // ----
+
+        size_type size () const {
+            return _size;}
+
+        // --------
+        // snapshot
+        // --------
+
+        /**
+         * A copy that shares every block with this deque, for reading
+         * elsewhere while this one changes; the same as the copy
+         * constructor, by name.
+         */
+        cow_deque snapshot () const {
+            return *this;}
+
+        // ----
+        // swap
+        // ----
+
+        void swap (cow_deque& that) {
+            std::swap(_a, that._a);
+            std::swap(_ba, that._ba);
+            _map.swap(that._map);
+            std::swap(_front, that._front);
+            std::swap(_size, that._size);}};
+
+#endif // CowDeque_h
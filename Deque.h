@@ -11,12 +11,17 @@
 // includes
 // --------
 
-#include <algorithm> // copy, equal, lexicographical_compare, max, swap
+#include <algorithm> // copy, count, equal, fill, find, max, min, move, move_backward, rotate, swap
 #include <cassert>   // assert
-#include <iterator>  // iterator, bidirectional_iterator_tag
-#include <memory>    // allocator
+#include <cstddef>   // ptrdiff_t, size_t
+#include <cstring>   // memcpy
+#include <iterator>  // advance, distance, forward_iterator_tag, iterator_traits, make_move_iterator, move_iterator, random_access_iterator_tag
+#include <memory>    // allocator, allocator_traits
+#include <numeric>   // accumulate
+#include <ostream>   // ostream
 #include <stdexcept> // out_of_range
-#include <utility>   // !=, <=, >, >=
+#include <type_traits> // enable_if, integral_constant, is_integral, is_same, is_trivially_copyable, is_trivially_destructible
+#include <utility>   // !=, <=, >, >=, forward, move
 
 // -----
 // using
@@ -27,23 +32,88 @@ using std::rel_ops::operator<=;
 using std::rel_ops::operator>;
 using std::rel_ops::operator>=;
 
+// --------------------------
+// my_deque_trivial_allocator
+// --------------------------
+
+/**
+ * True if A's construct and destroy do nothing beyond placement new and
+ * ~T(), so they may be skipped or replaced by raw memory operations for
+ * suitable element types. Specialize it for such allocators.
+ */
+template <typename A>
+struct my_deque_trivial_allocator :
+        std::is_same<A, std::allocator<typename A::value_type> > {};
+
+/**
+ * Elements are copied with memcpy.
+ */
+template <typename A>
+struct my_deque_trivial_copy : std::integral_constant<bool,
+        my_deque_trivial_allocator<A>::value &&
+        std::is_trivially_copyable<typename A::value_type>::value> {};
+
+/**
+ * Elements are never destroyed.
+ */
+template <typename A>
+struct my_deque_trivial_destroy : std::integral_constant<bool,
+        my_deque_trivial_allocator<A>::value &&
+        std::is_trivially_destructible<typename A::value_type>::value> {};
+
+// ------------
+// base_pointer
+// ------------
+
+/**
+ * is_pointer_to<I, T> holds if I walks contiguous T, in which case
+ * base_pointer(i) is an address that can be handed to memcpy.
+ */
+template <typename I, typename T>
+struct is_pointer_to : std::false_type {};
+
+template <typename T>
+struct is_pointer_to<T*, T> : std::true_type {};
+
+template <typename T>
+struct is_pointer_to<const T*, T> : std::true_type {};
+
+template <typename T>
+struct is_pointer_to<std::move_iterator<T*>, T> : std::true_type {};
+
+template <typename T>
+const T* base_pointer (const T* p) {
+    return p;}
+
+template <typename T>
+const T* base_pointer (std::move_iterator<T*> p) {
+    return p.base();}
+
 // -------
 // destroy
 // -------
 
 template <typename A, typename BI>
-BI destroy (A& a, BI b, BI e) {
+BI destroy (A& a, BI b, BI e, std::false_type) {
     while (b != e) {
         --e;
         a.destroy(&*e);}
     return b;}
 
+template <typename A, typename BI>
+BI destroy (A&, BI b, BI, std::true_type) {
+    return b;}
+
+template <typename A, typename BI>
+BI destroy (A& a, BI b, BI e) {
+    return destroy(a, b, e, my_deque_trivial_destroy<A>());}
+
 // ------------------
 // uninitialized_copy
 // ------------------
 
 template <typename A, typename II, typename BI>
-BI uninitialized_copy (A& a, II b, II e, BI x) {
+BI uninitialized_copy (A& a, II b, II e, BI x, std::false_type) {
     BI p = x;
     try {
         while (b != e) {
@@ -55,12 +125,25 @@ BI uninitialized_copy (A& a, II b, II e, BI x) {
         throw;}
     return x;}
 
+template <typename A, typename II, typename T>
+T* uninitialized_copy (A&, II b, II e, T* x, std::true_type) {
+    const std::ptrdiff_t n = e - b;
+    if (n != 0)
+        std::memcpy(x, base_pointer(b), n * sizeof(T));
+    return x + n;}
+
+template <typename A, typename II, typename BI>
+BI uninitialized_copy (A& a, II b, II e, BI x) {
+    typedef typename A::value_type T;
+    return uninitialized_copy(a, b, e, x, std::integral_constant<bool,
+        my_deque_trivial_copy<A>::value && std::is_same<BI, T*>::value && is_pointer_to<II, T>::value>());}
+
 // ------------------
 // uninitialized_fill
 // ------------------
 
 template <typename A, typename BI, typename U>
-BI uninitialized_fill (A& a, BI b, BI e, const U& v) {
+BI uninitialized_fill (A& a, BI b, BI e, const U& v, std::false_type) {
     BI p = b;
     try {
         while (b != e) {
@@ -71,12 +154,207 @@ BI uninitialized_fill (A& a, BI b, BI e, const U& v) {
         throw;}
     return e;}
 
-// -------
+template <typename A, typename T>
+T* uninitialized_fill (A&, T* b, T* e, const T& v, std::true_type) {
+    std::fill(b, e, v);
+    return e;}
+
+template <typename A, typename BI, typename U>
+BI uninitialized_fill (A& a, BI b, BI e, const U& v) {
+    typedef typename A::value_type T;
+    return uninitialized_fill(a, b, e, v, std::integral_constant<bool,
+        my_deque_trivial_copy<A>::value && std::is_same<BI, T*>::value && std::is_same<U, T>::value>());}
+
+// -------------------
+// my_deque_block_size
+// -------------------
+
+/**
+ * Largest power of two that is <= n (1 for n == 0).
+ */
+constexpr std::size_t my_deque_floor2 (std::size_t n) {
+    return (n < 2) ? 1 : 2 * my_deque_floor2(n / 2);}
+
+/**
+ * Default number of elements per block: as many T as fit in 4 KiB,
+ * rounded down to a power of two so that the index math in my_deque
+ * compiles to shifts and masks, and never fewer than 16.
+ */
+template <typename T>
+struct my_deque_block_size {
+    static const std::size_t bytes = 4096;
+    static const std::size_t value =
+        (my_deque_floor2(bytes / sizeof(T)) < 16) ? 16 : my_deque_floor2(bytes / sizeof(T));};
+
+// --------------------------
+// my_deque_prefetch_distance
+// --------------------------
+
+#ifndef MY_DEQUE_PREFETCH_DISTANCE
+#define MY_DEQUE_PREFETCH_DISTANCE 1
+#endif
+
+/**
+ * How many blocks ahead of the one being read a segmented traversal of
+ * my_deque prefetches; 0 turns prefetching off. The default comes from
+ * MY_DEQUE_PREFETCH_DISTANCE, so a build can set it for every T with
+ * -DMY_DEQUE_PREFETCH_DISTANCE=<n>; specialize this to tune one T.
+ */
+template <typename T>
+struct my_deque_prefetch_distance {
+    static const std::size_t value = MY_DEQUE_PREFETCH_DISTANCE;};
+
+/**
+ * Hints that the n bytes at p are about to be read, one cache line at a
+ * time; does nothing for a null p or without GCC's prefetch builtin.
+ */
+inline void my_deque_prefetch (const void* p, std::size_t n) {
+#if defined(__GNUC__)
+    if (!p || !n)
+        return;
+    const char* const c = static_cast<const char*>(p);
+    for (std::size_t i = 0; i < n; i += 64)
+        __builtin_prefetch(c + i);
+    __builtin_prefetch(c + n - 1);
+#else
+    (void) p;
+    (void) n;
+#endif
+    }
+
+// -----------------
+// my_deque_no_stats
+// -----------------
+
+/**
+ * Stats policy that counts nothing: every hook is an empty inline call
+ * and the policy is an empty base, so a my_deque with it is exactly as
+ * big and as fast as one without hooks.
+ */
+struct my_deque_no_stats {
+    void on_block_allocate ()            {}
+    void on_block_reuse    ()            {}
+    void on_block_free     ()            {}
+    void on_map_allocate   (std::size_t) {}
+    void on_map_recentre   (std::size_t) {}
+    void on_shift          (std::size_t) {}
+    void on_grow           (std::size_t) {}
+    void on_sample         (std::size_t) {}};
+
+// --------------
+// my_deque_stats
+// --------------
+
+/**
+ * Stats policy that counts what a deque does with its memory, for
+ * my_deque<T, A, B, my_deque_stats>. The map never moves elements, so
+ * growth costs block pointers (slots_moved) rather than element copies;
+ * elements move only when insert or erase shifts one side of a gap
+ * (elements_shifted). wasted_bytes is the unused part of the first and
+ * last live blocks, as of the my_deque::stats() call that made this copy.
+ */
+struct my_deque_stats {
+    std::size_t blocks_allocated;   // blocks obtained from the allocator
+    std::size_t blocks_reused;      // blocks taken off the spare stack
+    std::size_t blocks_freed;       // blocks given back to the allocator
+    std::size_t peak_blocks;        // most blocks held at once, spares included
+    std::size_t maps_allocated;     // maps allocated, the first one included
+    std::size_t maps_recentred;     // live blocks recentred in place
+    std::size_t slots_moved;        // block pointers copied or rotated by the two above
+    std::size_t elements_shifted;   // elements moved by insert and erase
+    std::size_t peak_size;
+    std::size_t wasted_bytes;
+
+    my_deque_stats () :
+            blocks_allocated (0),
+            blocks_reused    (0),
+            blocks_freed     (0),
+            peak_blocks      (0),
+            maps_allocated   (0),
+            maps_recentred   (0),
+            slots_moved      (0),
+            elements_shifted (0),
+            peak_size        (0),
+            wasted_bytes     (0) {}
+
+    // -----
+    // hooks
+    // -----
+
+    void on_block_allocate () {
+        ++blocks_allocated;
+        peak_blocks = std::max(peak_blocks, blocks_allocated - blocks_freed);}
+
+    void on_block_reuse () {
+        ++blocks_reused;}
+
+    void on_block_free () {
+        ++blocks_freed;}
+
+    void on_map_allocate (std::size_t slots) {
+        ++maps_allocated;
+        slots_moved += slots;}
+
+    void on_map_recentre (std::size_t slots) {
+        ++maps_recentred;
+        slots_moved += slots;}
+
+    void on_shift (std::size_t n) {
+        elements_shifted += n;}
+
+    void on_grow (std::size_t size) {
+        peak_size = std::max(peak_size, size);}
+
+    void on_sample (std::size_t wasted) {
+        wasted_bytes = wasted;}
+
+    // -----------
+    // operator +=
+    // -----------
+
+    /**
+     * Aggregates the counts of another deque: events and wasted bytes
+     * add up, peaks are the larger of the two.
+     */
+    my_deque_stats& operator += (const my_deque_stats& rhs) {
+        blocks_allocated += rhs.blocks_allocated;
+        blocks_reused    += rhs.blocks_reused;
+        blocks_freed     += rhs.blocks_freed;
+        peak_blocks       = std::max(peak_blocks, rhs.peak_blocks);
+        maps_allocated   += rhs.maps_allocated;
+        maps_recentred   += rhs.maps_recentred;
+        slots_moved      += rhs.slots_moved;
+        elements_shifted += rhs.elements_shifted;
+        peak_size         = std::max(peak_size, rhs.peak_size);
+        wasted_bytes     += rhs.wasted_bytes;
+        return *this;}};
+
+/**
+ * Writes the counts as one line of name=value pairs.
+ */
+inline std::ostream& operator << (std::ostream& lhs, const my_deque_stats& rhs) {
+    return lhs << "blocks_allocated="  << rhs.blocks_allocated
+               << " blocks_reused="    << rhs.blocks_reused
+               << " blocks_freed="     << rhs.blocks_freed
+               << " peak_blocks="      << rhs.peak_blocks
+               << " maps_allocated="   << rhs.maps_allocated
+               << " maps_recentred="   << rhs.maps_recentred
+               << " slots_moved="      << rhs.slots_moved
+               << " elements_shifted=" << rhs.elements_shifted
+               << " peak_size="        << rhs.peak_size
+               << " wasted_bytes="     << rhs.wasted_bytes;}
+
+// --------
 // my_deque
-// -------
+// --------
 
-template < typename T, typename A = std::allocator<T> >
-class my_deque {
+/**
+ * S is the stats policy: my_deque_no_stats, or my_deque_stats to count
+ * allocations and moves. It is a private base, so an empty one costs no
+ * space.
+ */
+template < typename T, typename A = std::allocator<T>, std::size_t B = my_deque_block_size<T>::value, typename S = my_deque_no_stats >
+class my_deque : private S {
     public:
         // --------
         // typedefs
@@ -84,6 +362,7 @@ class my_deque {
 
         typedef A                                        allocator_type;
         typedef typename allocator_type::value_type      value_type;
+        typedef S                                        stats_type;
 
         typedef typename allocator_type::size_type       size_type;
         typedef typename allocator_type::difference_type difference_type;
@@ -94,63 +373,474 @@ class my_deque {
         typedef typename allocator_type::reference       reference;
         typedef typename allocator_type::const_reference const_reference;
 
+        /**
+         * Allocator for the map of block pointers, rebound from A.
+         */
+        typedef typename std::allocator_traits<A>::template rebind_alloc<pointer> map_allocator_type;
+
+    private:
+        typedef std::allocator_traits<A> allocator_traits;
+
+    public:
+
+        // ---------
+        // constants
+        // ---------
+
+        /**
+         * Number of elements per block. When it is a power of two the
+         * divisions and remainders by block_size below become shifts and masks.
+         */
+        static const size_type block_size = B;
+
+        static_assert(B > 0, "my_deque block size must be positive");
+
+        /**
+         * Drained blocks kept for reuse unless max_spare_blocks says
+         * otherwise: one for each end.
+         */
+        static const size_type default_spare_blocks = 2;
+
     public:
         // -----------
         // operator ==
         // -----------
 
         /**
-         * <your documentation>
+         * Same size and equal elements, compared block run by block run.
          */
         friend bool operator == (const my_deque& lhs, const my_deque& rhs) {
-            return (lhs.size() == rhs.size()) && std::equal(lhs.begin(), lhs.end(), rhs.begin());}
+            return (lhs.size() == rhs.size()) && equal(lhs.begin(), lhs.end(), rhs.begin());}
 
         // ----------
         // operator <
         // ----------
 
         /**
-         * <your documentation>
+         * Lexicographical order, compared block run by block run.
          */
         friend bool operator < (const my_deque& lhs, const my_deque& rhs) {
-            return std::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());}
+            return less_than(lhs, rhs);}
 
     private:
         // ----
         // data
         // ----
 
-        allocator_type _a;
-        std::allocator<pointer> _pa;
+        allocator_type     _a;
+        map_allocator_type _pa;
 
         pointer* _bl;
         pointer* _el;
 
         pointer* _b;
         pointer _bi;
+        size_type _start;       // front_offset(), kept so indexing needs no _b or _bi
         size_type _size;
         size_type _outer_size;
 
+        pointer   _spare;
+        size_type _spares;
+        size_type _spare_max;
+        size_type _allocations;
+        bool      _auto_shrink;
+
     private:
         // -----
         // valid
         // -----
 
         bool valid () const {
-            return (!_bl && !_el && !_b && !_bi) || ((_bl <= _b) && (_b <= _el));}
+            return (!_bl && !_el && !_b && !_bi && !_size && !_start) ||
+                   ((_bl <= _b) && (_b < _el) && !*_el && *_b && (*_b <= _bi) && (_bi < (*_b + B)) &&
+                    (_start == (((_b - _bl) * B) + (_bi - *_b))));}
+
+        // ------------
+        // front_offset
+        // ------------
+
+        /**
+         * Element slot of the front, counted from the start of the map.
+         */
+        size_type front_offset () const {
+            return _start;}
+
+        /**
+         * Recomputes _start after the map moved under _b.
+         */
+        void reset_start () {
+            _start = _b ? (((_b - _bl) * B) + (_bi - *_b)) : 0;}
+
+        // --------------
+        // allocate_block
+        // --------------
+
+        /**
+         * Returns storage for one block: the most recently drained spare
+         * if there is one, a new block otherwise.
+         */
+        pointer allocate_block () {
+            pointer p = _spare;
+            if (p) {
+                std::memcpy(&_spare, static_cast<const void*>(p), sizeof(pointer));
+                --_spares;
+                this->on_block_reuse();}
+            else {
+                p = _a.allocate(B);
+                ++_allocations;
+                this->on_block_allocate();}
+            return p;}
+
+        // -------------
+        // release_block
+        // -------------
+
+        /**
+         * Takes the block out of map slot n. It goes on the spare stack,
+         * linked through its first bytes, unless the stack is full or the
+         * block is too small to hold the link; then it is freed.
+         */
+        void release_block (pointer* n) {
+            if ((_spares < _spare_max) && ((B * sizeof(value_type)) >= sizeof(pointer))) {
+                std::memcpy(static_cast<void*>(*n), &_spare, sizeof(pointer));
+                _spare = *n;
+                ++_spares;}
+            else {
+                _a.deallocate(*n, B);
+                this->on_block_free();}
+            *n = 0;}
+
+        /**
+         * Releases the blocks in the map slots [b, e), which no longer
+         * hold elements.
+         */
+        void release_blocks (pointer* b, pointer* e) {
+            for (; b < e; ++b)
+                if (*b)
+                    release_block(b);}
+
+        // -----------
+        // trim_spares
+        // -----------
+
+        /**
+         * Frees spare blocks until no more than n remain.
+         */
+        void trim_spares (size_type n) {
+            while (_spares > n) {
+                const pointer p = _spare;
+                std::memcpy(&_spare, static_cast<const void*>(p), sizeof(pointer));
+                _a.deallocate(p, B);
+                this->on_block_free();
+                --_spares;}}
+
+        // --------
+        // live_end
+        // --------
+
+        /**
+         * One past the map slot of the last live block; the front block
+         * counts as live even when the deque is empty.
+         */
+        pointer* live_end () const {
+            const size_type e = front_offset() + size();
+            return std::max(_b + 1, _bl + ((e + B - 1) / B));}
+
+        // ---------------
+        // allocate_blocks
+        // ---------------
+
+        /**
+         * Gives every empty map slot in [b, e) a block.
+         */
+        void allocate_blocks (pointer* b, pointer* e) {
+            while (b != e) {
+                if (!*b)
+                    *b = allocate_block();
+                ++b;}}
+
+        // --------------
+        // deallocate_map
+        // --------------
+
+        /**
+         * Destroys the elements and frees every block and the map.
+         */
+        void deallocate_map () {
+            if (_bl) {
+                destroy(_a, begin(), end());
+                pointer* copy = _bl;
+                while (copy != _el) {
+                    if (*copy) {
+                        _a.deallocate(*copy, B);
+                        this->on_block_free();}
+                    ++copy;}
+                _pa.deallocate(_bl, _outer_size + 1);}
+            trim_spares(0);
+            _bl = _el = _b = 0;
+            _bi = 0;
+            _size = _outer_size = _start = 0;}
+
+        // ----------
+        // shrink_map
+        // ----------
+
+        /**
+         * Releases every block outside the live range and, if the map has
+         * more than n slots (never fewer than the live blocks), moves the
+         * live block pointers to the middle of a map of n. Blocks stay
+         * where they are, so references to elements stay valid.
+         */
+        void shrink_map (size_type n) {
+            pointer* const le = live_end();
+            const size_type live = le - _b;
+            release_blocks(_bl, _b);
+            release_blocks(le, _el);
+            n = std::max(n, live);
+            if (n >= _outer_size)
+                return;
+            pointer* bl = _pa.allocate(n + 1);
+            std::fill(bl, bl + n + 1, pointer(0));
+            const size_type nf = (n - live) / 2;
+            std::copy(_b, le, bl + nf);
+            this->on_map_allocate(live);
+            _pa.deallocate(_bl, _outer_size + 1);
+            _bl = bl;
+            _el = bl + n;
+            _outer_size = n;
+            _b = bl + nf;
+            reset_start();}
+
+        // ---------------
+        // auto_shrink_map
+        // ---------------
+
+        /**
+         * With auto_shrink on, shrinks the map to twice the live blocks
+         * once they fill a quarter of it or less. Growth doubles the map,
+         * so a deque has to shrink fourfold again before the next shrink,
+         * and one hovering around a size never flips between the two.
+         */
+        void auto_shrink_map () {
+            if (!_auto_shrink || !_bl || (_outer_size < 16))
+                return;
+            const size_type live = live_end() - _b;
+            if ((4 * live) <= _outer_size)
+                shrink_map(2 * live);}
+
+        // -----------
+        // reserve_map
+        // -----------
+
+        /**
+         * Makes sure the map has slots for front more elements before the
+         * front and back more after the back. Only block pointers move:
+         * if the map is at least twice as big as needed the slots are
+         * rotated to recentre the live blocks, otherwise the slots are
+         * copied into a map about twice as big, again centred. Elements
+         * never move, so references to them stay valid. Blocks outside
+         * the live range (reserved ones) move with their slots. A deque
+         * without a map gets one, with a block for its front.
+         */
+        void reserve_map (size_type front, size_type back) {
+            const size_type f     = front_offset();
+            const size_type e     = f + size();
+            const size_type first = f / B;
+            const size_type last  = std::max(first + 1, (e + B - 1) / B);
+            const size_type room  = (last * B) - e;
+            const size_type fn    = (front <= (f % B)) ? 0 : (((front - (f % B)) + B - 1) / B);
+            const size_type bn    = (back  <= room)    ? 0 : (((back  - room)    + B - 1) / B);
+            if (_bl && (fn <= first) && ((last + bn) <= _outer_size))
+                return;
+
+            const size_type need = fn + (last - first) + bn;
+            if (_bl && ((2 * need) <= _outer_size)) {
+                const size_type nf = ((_outer_size - need) / 2) + fn;
+                if (nf < first)
+                    std::rotate(_bl, _bl + (first - nf), _el);
+                else
+                    std::rotate(_bl, _el - (nf - first), _el);
+                this->on_map_recentre(_outer_size);
+                _b = _bl + nf;}
+            else {
+                const size_type n  = _outer_size + std::max(_outer_size, need) + 2;
+                const size_type nf = ((n - need) / 2) + fn;
+                pointer* bl = _pa.allocate(n + 1);
+                std::fill(bl, bl + n + 1, pointer(0));
+                for (size_type i = 0; i != _outer_size; ++i)
+                    bl[(i + n + nf - first) % n] = _bl[i];
+                this->on_map_allocate(_outer_size);
+                if (_bl)
+                    _pa.deallocate(_bl, _outer_size + 1);
+                _bl = bl;
+                _el = bl + n;
+                _outer_size = n;
+                if (_b)
+                    _b = bl + nf;
+                else {
+                    _b = bl + nf;
+                    *_b = _bi = allocate_block();}}
+            reset_start();
+            assert(valid());}
+
+        // --------------
+        // construct_back
+        // --------------
+
+        /**
+         * Constructs n elements after the back, block by block: an empty
+         * map slot gets its block only when the first element lands in it.
+         * f(p, k) constructs k elements at p and cleans up after itself if
+         * it throws; the elements of earlier blocks are then destroyed too,
+         * so either all n are added or none.
+         */
+        template <typename F>
+        void construct_back (size_type n, F f) {
+            reserve_map(0, n);
+            const size_type e = front_offset() + size();
+            size_type i = 0;
+            try {
+                while (i != n) {
+                    const size_type o = e + i;
+                    pointer* node = _bl + (o / B);
+                    if (!*node)
+                        *node = allocate_block();
+                    const size_type k = std::min(n - i, B - (o % B));
+                    f(*node + (o % B), k);
+                    i += k;}}
+            catch (...) {
+                destroy(_a, end(), end() + i);
+                throw;}
+            _size += n;
+            this->on_grow(_size);}
+
+        // ---------------
+        // construct_front
+        // ---------------
+
+        /**
+         * Constructs n elements before the front, front to back, the same
+         * way construct_back does after the back: the new front becomes
+         * visible only once all n are in.
+         */
+        template <typename F>
+        void construct_front (size_type n, F f) {
+            if (n == 0)
+                return;
+            reserve_map(n, 0);
+            const size_type s = front_offset() - n;
+            size_type i = 0;
+            try {
+                while (i != n) {
+                    const size_type o = s + i;
+                    pointer* node = _bl + (o / B);
+                    if (!*node)
+                        *node = allocate_block();
+                    const size_type k = std::min(n - i, B - (o % B));
+                    f(*node + (o % B), k);
+                    i += k;}}
+            catch (...) {
+                if (i != 0)
+                    destroy(_a, begin() - n, begin() - (n - i));
+                throw;}
+            _b = _bl + (s / B);
+            _bi = *_b + (s % B);
+            _start = s;
+            _size += n;
+            this->on_grow(_size);}
+
+        // --------------
+        // copy_allocator
+        // --------------
+
+        /**
+         * Takes a, and a map allocator rebound from it, when the traits
+         * say to propagate it (true_type); keeps the current ones otherwise.
+         */
+        void copy_allocator (const allocator_type& a, std::true_type) {
+            _a  = a;
+            _pa = map_allocator_type(_a);}
+
+        void copy_allocator (const allocator_type&, std::false_type) {}
+
+        void swap_allocator (my_deque& that, std::true_type) {
+            using std::swap;
+            swap(_a,  that._a);
+            swap(_pa, that._pa);}
+
+        void swap_allocator (my_deque&, std::false_type) {}
+
+        // ----
+        // take
+        // ----
+
+        /**
+         * Takes over that's blocks, spares and stats, leaving that empty;
+         * *this must have no map and its allocator must be able to free
+         * that's blocks.
+         */
+        void take (my_deque& that) {
+            _bl = that._bl;
+            _el = that._el;
+            _b = that._b;
+            _bi = that._bi;
+            _start = that._start;
+            _size = that._size;
+            _outer_size = that._outer_size;
+            _spare = that._spare;
+            _spares = that._spares;
+            _allocations = that._allocations;
+            static_cast<S&>(*this) = static_cast<const S&>(that);
+            that._bl = that._el = that._b = 0;
+            that._bi = 0;
+            that._size = that._outer_size = that._start = 0;
+            that._spares = that._allocations = 0;
+            that._spare = 0;
+            static_cast<S&>(that) = S();}
+
+        // ------
+        // assign
+        // ------
+
+        /**
+         * Replaces the contents with [b, e): assigns over the live
+         * elements and constructs only the ones past the old back.
+         */
+        template <typename RI>
+        void assign (RI b, RI e) {
+            const size_type n = e - b;
+            if (n <= size()) {
+                copy_segments(b, e, begin());
+                destroy(_a, begin() + n, end());}
+            else {
+                RI m = b + size();
+                copy_segments(b, m, begin());
+                construct_back(n - size(), [&] (pointer p, size_type k) {
+                    uninitialized_copy_segments(m, k, p);
+                    m += k;});}
+            _size = n;}
+
+    public:
+        class const_iterator;
 
     public:
         // --------
         // iterator
         // --------
 
+        /**
+         * Segmented random-access iterator. It holds the current element,
+         * the bounds of the block it is in and that block's map slot, so
+         * ++, -- and * are pointer operations and only a block crossing
+         * goes back to the map.
+         */
         class iterator {
             public:
                 // --------
                 // typedefs
                 // --------
 
-                typedef std::bidirectional_iterator_tag   iterator_category;
+                typedef std::random_access_iterator_tag    iterator_category;
                 typedef typename my_deque::value_type      value_type;
                 typedef typename my_deque::difference_type difference_type;
                 typedef typename my_deque::pointer         pointer;
@@ -162,44 +852,71 @@ class my_deque {
                 // -----------
 
                 /**
-                 * <your documentation>
+                 * Two iterators are equal if they point at the same element.
                  */
                 friend bool operator == (const iterator& lhs, const iterator& rhs) {
-                    return ((lhs._p == rhs._p) && (lhs._i == rhs._i));}
+                    return (lhs._cur == rhs._cur);}
 
                 /**
-                 * <your documentation>
+                 * Negation of ==.
                  */
                 friend bool operator != (const iterator& lhs, const iterator& rhs) {
                     return !(lhs == rhs);}
 
+                // ----------
+                // operator <
+                // ----------
+
+                /**
+                 * Orders by map slot first, then by position in the block.
+                 */
+                friend bool operator < (const iterator& lhs, const iterator& rhs) {
+                    return (lhs._node == rhs._node) ? (lhs._cur < rhs._cur) : (lhs._node < rhs._node);}
+
                 // ----------
                 // operator +
                 // ----------
 
                 /**
-                 * <your documentation>
+                 * Returns lhs advanced by rhs elements.
                  */
                 friend iterator operator + (iterator lhs, difference_type rhs) {
                     return lhs += rhs;}
 
+                /**
+                 * Returns rhs advanced by lhs elements.
+                 */
+                friend iterator operator + (difference_type lhs, iterator rhs) {
+                    return rhs += lhs;}
+
                 // ----------
                 // operator -
                 // ----------
 
                 /**
-                 * <your documentation>
+                 * Returns lhs moved back by rhs elements.
                  */
                 friend iterator operator - (iterator lhs, difference_type rhs) {
                     return lhs -= rhs;}
 
+                /**
+                 * Returns the number of elements from rhs to lhs.
+                 */
+                friend difference_type operator - (const iterator& lhs, const iterator& rhs) {
+                    return (difference_type(B) * (lhs._node - rhs._node)) + (lhs._cur - lhs._first) - (rhs._cur - rhs._first);}
+
             private:
                 // ----
                 // data
                 // ----
 
-                my_deque* _p;
-                difference_type _i;
+                pointer  _cur;
+                pointer  _first;
+                pointer  _last;
+                typename my_deque::pointer* _node;
+
+                friend class my_deque;
+                friend class const_iterator;
 
             private:
                 // -----
@@ -207,7 +924,20 @@ class my_deque {
                 // -----
 
                 bool valid () const {
-                    return (_p && (_i >= 0));}
+                    return (!_cur && !_first) || ((_first <= _cur) && (_cur < _last));}
+
+                // --------
+                // set_node
+                // --------
+
+                /**
+                 * Moves to map slot n; an unallocated slot (the sentinel
+                 * past the last block) leaves the block bounds null.
+                 */
+                void set_node (typename my_deque::pointer* n) {
+                    _node  = n;
+                    _first = *n;
+                    _last  = _first ? _first + B : 0;}
 
             public:
                 // -----------
@@ -215,11 +945,16 @@ class my_deque {
                 // -----------
 
                 /**
-                 * <your documentation>
+                 * Singular iterator, also the begin and end of a deque with no map.
+                 */
+                iterator () : _cur(0), _first(0), _last(0), _node(0) {}
+
+                /**
+                 * iterator to element c in the block held by map slot n.
                  */
-                iterator (my_deque* p, difference_type i) : _p(p), _i(i) {
-                    _p = p;
-                    _i = i;
+                iterator (typename my_deque::pointer* n, pointer c) : _cur(c), _first(0), _last(0), _node(n) {
+                    if (n)
+                        set_node(n);
                     assert(valid());}
 
                 // Default copy, destructor, and copy assignment.
@@ -232,35 +967,49 @@ class my_deque {
                 // ----------
 
                 /**
-                 * <your documentation>
+                 * Returns the element pointed at.
                  */
                 reference operator * () const {
-                    return _p->operator[](_i);}
+                    return *_cur;}
 
                 // -----------
                 // operator ->
                 // -----------
 
                 /**
-                 * <your documentation>
+                 * Returns a pointer to the element pointed at.
                  */
                 pointer operator -> () const {
                     return &**this;}
 
+                // -----------
+                // operator []
+                // -----------
+
+                /**
+                 * Returns the element d positions away.
+                 */
+                reference operator [] (difference_type d) const {
+                    return *(*this + d);}
+
                 // -----------
                 // operator ++
                 // -----------
 
                 /**
-                 * <your documentation>
+                 * Bumps the element pointer, crossing to the next map slot
+                 * at the end of a block.
                  */
                 iterator& operator ++ () {
-                    ++_i;
+                    ++_cur;
+                    if (_cur == _last) {
+                        set_node(_node + 1);
+                        _cur = _first;}
                     assert(valid());
                     return *this;}
 
                 /**
-                 * <your documentation>
+                 * Post-increment.
                  */
                 iterator operator ++ (int) {
                     iterator x = *this;
@@ -273,15 +1022,19 @@ class my_deque {
                 // -----------
 
                 /**
-                 * <your documentation>
+                 * Steps the element pointer back, crossing to the previous
+                 * map slot at the start of a block.
                  */
                 iterator& operator -- () {
-                    --_i;
+                    if (_cur == _first) {
+                        set_node(_node - 1);
+                        _cur = _last;}
+                    --_cur;
                     assert(valid());
                     return *this;}
 
                 /**
-                 * <your documentation>
+                 * Post-decrement.
                  */
                 iterator operator -- (int) {
                     iterator x = *this;
@@ -294,10 +1047,18 @@ class my_deque {
                 // -----------
 
                 /**
-                 * <your documentation>
+                 * Advances by d elements: a pointer bump inside the block,
+                 * otherwise one jump through the map.
                  */
                 iterator& operator += (difference_type d) {
-                    _i = _i + d;
+                    const difference_type b = B;
+                    const difference_type o = d + (_cur - _first);
+                    if ((o >= 0) && (o < b))
+                        _cur += d;
+                    else {
+                        const difference_type n = (o >= 0) ? (o / b) : (-((-o - 1) / b) - 1);
+                        set_node(_node + n);
+                        _cur = _first + (o - (n * b));}
                     assert(valid());
                     return *this;}
 
@@ -306,25 +1067,29 @@ class my_deque {
                 // -----------
 
                 /**
-                 * <your documentation>
+                 * Moves back by d elements.
                  */
                 iterator& operator -= (difference_type d) {
-                    _i = _i - d;
-                    assert(valid());
-                    return *this;}};
+                    return *this += -d;}};
 
     public:
         // --------------
         // const_iterator
         // --------------
 
+        /**
+         * Segmented random-access iterator over const elements. It holds the current element,
+         * the bounds of the block it is in and that block's map slot, so
+         * ++, -- and * are pointer operations and only a block crossing
+         * goes back to the map.
+         */
         class const_iterator {
             public:
                 // --------
                 // typedefs
                 // --------
 
-                typedef std::bidirectional_iterator_tag   iterator_category;
+                typedef std::random_access_iterator_tag    iterator_category;
                 typedef typename my_deque::value_type      value_type;
                 typedef typename my_deque::difference_type difference_type;
                 typedef typename my_deque::const_pointer   pointer;
@@ -336,44 +1101,70 @@ class my_deque {
                 // -----------
 
                 /**
-                 * <your documentation>
+                 * Two const_iterators are equal if they point at the same element.
                  */
                 friend bool operator == (const const_iterator& lhs, const const_iterator& rhs) {
-                    return ((lhs._p == rhs._p) && (lhs._i == rhs._i));}
+                    return (lhs._cur == rhs._cur);}
 
                 /**
-                 * <your documentation>
+                 * Negation of ==.
                  */
                 friend bool operator != (const const_iterator& lhs, const const_iterator& rhs) {
                     return !(lhs == rhs);}
 
+                // ----------
+                // operator <
+                // ----------
+
+                /**
+                 * Orders by map slot first, then by position in the block.
+                 */
+                friend bool operator < (const const_iterator& lhs, const const_iterator& rhs) {
+                    return (lhs._node == rhs._node) ? (lhs._cur < rhs._cur) : (lhs._node < rhs._node);}
+
                 // ----------
                 // operator +
                 // ----------
 
                 /**
-                 * <your documentation>
+                 * Returns lhs advanced by rhs elements.
                  */
                 friend const_iterator operator + (const_iterator lhs, difference_type rhs) {
                     return lhs += rhs;}
 
+                /**
+                 * Returns rhs advanced by lhs elements.
+                 */
+                friend const_iterator operator + (difference_type lhs, const_iterator rhs) {
+                    return rhs += lhs;}
+
                 // ----------
                 // operator -
                 // ----------
 
                 /**
-                 * <your documentation>
+                 * Returns lhs moved back by rhs elements.
                  */
                 friend const_iterator operator - (const_iterator lhs, difference_type rhs) {
                     return lhs -= rhs;}
 
+                /**
+                 * Returns the number of elements from rhs to lhs.
+                 */
+                friend difference_type operator - (const const_iterator& lhs, const const_iterator& rhs) {
+                    return (difference_type(B) * (lhs._node - rhs._node)) + (lhs._cur - lhs._first) - (rhs._cur - rhs._first);}
+
             private:
                 // ----
                 // data
                 // ----
 
-                const my_deque* _p;
-                difference_type _i;
+                pointer  _cur;
+                pointer  _first;
+                pointer  _last;
+                typename my_deque::pointer* _node;
+
+                friend class my_deque;
 
             private:
                 // -----
@@ -381,7 +1172,20 @@ class my_deque {
                 // -----
 
                 bool valid () const {
-                    return (_p && (_i >= 0));}
+                    return (!_cur && !_first) || ((_first <= _cur) && (_cur < _last));}
+
+                // --------
+                // set_node
+                // --------
+
+                /**
+                 * Moves to map slot n; an unallocated slot (the sentinel
+                 * past the last block) leaves the block bounds null.
+                 */
+                void set_node (typename my_deque::pointer* n) {
+                    _node  = n;
+                    _first = *n;
+                    _last  = _first ? _first + B : 0;}
 
             public:
                 // -----------
@@ -389,11 +1193,22 @@ class my_deque {
                 // -----------
 
                 /**
-                 * <your documentation>
+                 * Singular const_iterator, also the begin and end of a deque with no map.
+                 */
+                const_iterator () : _cur(0), _first(0), _last(0), _node(0) {}
+
+                /**
+                 * const_iterator to element c in the block held by map slot n.
+                 */
+                const_iterator (typename my_deque::pointer* n, pointer c) : _cur(c), _first(0), _last(0), _node(n) {
+                    if (n)
+                        set_node(n);
+                    assert(valid());}
+
+                /**
+                 * Conversion from iterator.
                  */
-                const_iterator (const my_deque* p, difference_type i) : _p(p), _i(i) {
-                    _p = p;
-                    _i = i;
+                const_iterator (const iterator& rhs) : _cur(rhs._cur), _first(rhs._first), _last(rhs._last), _node(rhs._node) {
                     assert(valid());}
 
                 // Default copy, destructor, and copy assignment.
@@ -406,35 +1221,49 @@ class my_deque {
                 // ----------
 
                 /**
-                 * <your documentation>
+                 * Returns the element pointed at.
                  */
                 reference operator * () const {
-                    return _p->operator[](_i);}
+                    return *_cur;}
 
                 // -----------
                 // operator ->
                 // -----------
 
                 /**
-                 * <your documentation>
+                 * Returns a pointer to the element pointed at.
                  */
                 pointer operator -> () const {
                     return &**this;}
 
+                // -----------
+                // operator []
+                // -----------
+
+                /**
+                 * Returns the element d positions away.
+                 */
+                reference operator [] (difference_type d) const {
+                    return *(*this + d);}
+
                 // -----------
                 // operator ++
                 // -----------
 
                 /**
-                 * <your documentation>
+                 * Bumps the element pointer, crossing to the next map slot
+                 * at the end of a block.
                  */
                 const_iterator& operator ++ () {
-                    ++_i;
+                    ++_cur;
+                    if (_cur == _last) {
+                        set_node(_node + 1);
+                        _cur = _first;}
                     assert(valid());
                     return *this;}
 
                 /**
-                 * <your documentation>
+                 * Post-increment.
                  */
                 const_iterator operator ++ (int) {
                     const_iterator x = *this;
@@ -447,15 +1276,19 @@ class my_deque {
                 // -----------
 
                 /**
-                 * <your documentation>
+                 * Steps the element pointer back, crossing to the previous
+                 * map slot at the start of a block.
                  */
                 const_iterator& operator -- () {
-                    --_i;
+                    if (_cur == _first) {
+                        set_node(_node - 1);
+                        _cur = _last;}
+                    --_cur;
                     assert(valid());
                     return *this;}
 
                 /**
-                 * <your documentation>
+                 * Post-decrement.
                  */
                 const_iterator operator -- (int) {
                     const_iterator x = *this;
@@ -468,10 +1301,18 @@ class my_deque {
                 // -----------
 
                 /**
-                 * <your documentation>
+                 * Advances by d elements: a pointer bump inside the block,
+                 * otherwise one jump through the map.
                  */
                 const_iterator& operator += (difference_type d) {
-                    _i = _i + d;
+                    const difference_type b = B;
+                    const difference_type o = d + (_cur - _first);
+                    if ((o >= 0) && (o < b))
+                        _cur += d;
+                    else {
+                        const difference_type n = (o >= 0) ? (o / b) : (-((-o - 1) / b) - 1);
+                        set_node(_node + n);
+                        _cur = _first + (o - (n * b));}
                     assert(valid());
                     return *this;}
 
@@ -480,152 +1321,787 @@ class my_deque {
                 // -----------
 
                 /**
-                 * <your documentation>
+                 * Moves back by d elements.
                  */
                 const_iterator& operator -= (difference_type d) {
-                    _i = _i - d;
-                    assert(valid());
-                    return *this;}};
+                    return *this += -d;}};
 
     public:
-        // ------------
-        // constructors
-        // ------------
-
-        /**
-         * <your documentation>
-         */
-        explicit my_deque (const allocator_type& a = allocator_type()) : _a(a) {
-            _bl = _el = _b = 0;
-            _bi = 0;
-            _size = _outer_size = 0;
-            assert(valid());}
+        // -------
+        // segment
+        // -------
 
         /**
-         * <your documentation>
+         * A run of size contiguous elements starting at data, all in one
+         * block; begin and end make it a plain pointer range.
          */
-        explicit my_deque (size_type s, const_reference v = value_type(), const allocator_type& a = allocator_type()) : _a(a) {
-            _size = s; //_size - 1 is the laste index into the deque
-
-            if(_size == 0){
-                _bl = _el = _b = 0;
-                _bi = 0;
-                _size = _outer_size = 0;
-            }
-            else {
-                if((_size % 10) == 0){
-                    _outer_size = _size / 10;
-                }
-                else{
-                    _outer_size = (_size / 10) + 1;
-                }
+        template <typename P>
+        struct basic_segment {
+            P         data;
+            size_type size;
 
-                _bl = _b = _pa.allocate(_outer_size);
-                _el = _bl + _outer_size;
+            P begin () const {
+                return data;}
 
-                pointer* copy = _bl;
-                while(copy != _el){
-                    *copy = _a.allocate(10);
-                    ++copy;
-                }
+            P end () const {
+                return data + size;}};
 
-                _bi = *_bl;
+        typedef basic_segment<pointer>       segment;
+        typedef basic_segment<const_pointer> const_segment;
 
-                uninitialized_fill(_a, begin(), end(), v);
-            }
-            assert(valid());}
+        // ----------------
+        // segment_iterator
+        // ----------------
 
         /**
-         * <your documentation>
+         * Forward iterator over the segments of [i, e): each step covers
+         * the rest of the current block or of the range, whichever ends
+         * first. While a segment is being read, the blocks up to
+         * my_deque_prefetch_distance<T> ahead of it in the range are
+         * being prefetched, so a long scan does not stall on the next
+         * block's first cache miss.
          */
-        my_deque (const my_deque& that) : _a(that._a) {
-            _size = that.size(); //_size - 1 is the laste index into the deque
+        template <typename I, typename P>
+        class segment_iterator {
+            public:
+                // --------
+                // typedefs
+                // --------
 
-            if(_size == 0){
-                _bl = _el = _b = 0;
-                _bi = 0;
-                _size = _outer_size = 0;
-            }
-            else{ 
-                if((_size % 10) == 0){
-                    _outer_size = _size / 10;
-                }
-                else{
-                    _outer_size = (_size / 10) + 1;
-                }
+                typedef std::forward_iterator_tag iterator_category;
+                typedef basic_segment<P>          value_type;
+                typedef std::ptrdiff_t            difference_type;
+                typedef const value_type*         pointer;
+                typedef value_type                reference;
 
-                _bl = _b = _pa.allocate(_outer_size);
-                _el = _bl + _outer_size;
+            public:
+                // -----------
+                // operator ==
+                // -----------
 
-                pointer* copy = _bl;
-                while(copy != _el){
-                    *copy = _a.allocate(10);
-                    ++copy;
-                }
+                friend bool operator == (const segment_iterator& lhs, const segment_iterator& rhs) {
+                    return lhs._i == rhs._i;}
 
-                _bi = *_bl;
+                friend bool operator != (const segment_iterator& lhs, const segment_iterator& rhs) {
+                    return !(lhs == rhs);}
 
-                uninitialized_copy(_a, that.begin(), that.end(), begin());
-            }
-            assert(valid());}
+            private:
+                // ----
+                // data
+                // ----
 
-        // ----------
-        // destructor
-        // ----------
+                I _i;
+                I _e;
 
-        /**
-         * <your documentation>
-         */
-        ~my_deque () {
-            if(_bl){
-                clear();
-                pointer* copy = _bl;
-                while(copy != _el){
-                    _a.deallocate(*copy, 10);
-                    ++copy;
-                }
-                _pa.deallocate(_bl, _outer_size);
-            }
+                // --------
+                // prefetch
+                // --------
+
+                /**
+                 * Prefetches the block d map slots after _i's, if the
+                 * range reaches into it.
+                 */
+                void prefetch (size_type d) const {
+                    if ((d != 0) && ((_e._node - _i._node) >= difference_type(d)))
+                        prefetch_block(_i._node[d]);}
+
+            public:
+                // -----------
+                // constructor
+                // -----------
+
+                segment_iterator (I i, I e) : _i(i), _e(e) {
+                    for (size_type d = 1; d <= prefetch_distance; ++d)
+                        prefetch(d);}
+
+                // ----------
+                // operator *
+                // ----------
+
+                reference operator * () const {
+                    const value_type s = {&*_i, std::min<size_type>(run(_i), _e - _i)};
+                    return s;}
+
+                // -----------
+                // operator ++
+                // -----------
+
+                segment_iterator& operator ++ () {
+                    _i += (**this).size;
+                    prefetch(prefetch_distance);
+                    return *this;}
+
+                segment_iterator operator ++ (int) {
+                    segment_iterator x = *this;
+                    ++*this;
+                    return x;}};
+
+        // ------------
+        // segment_view
+        // ------------
+
+        /**
+         * The segments of [b, e) as a range, so that an algorithm can run
+         * an outer loop over blocks and a tight inner loop over pointers:
+         *
+         *     for (const auto& s : x.segments())
+         *         for (auto p = s.begin(); p != s.end(); ++p) ...
+         */
+        template <typename I, typename P>
+        class segment_view {
+            private:
+                I _b;
+                I _e;
+
+            public:
+                segment_view (I b, I e) : _b(b), _e(e) {}
+
+                segment_iterator<I, P> begin () const {
+                    return segment_iterator<I, P>(_b, _e);}
+
+                segment_iterator<I, P> end () const {
+                    return segment_iterator<I, P>(_e, _e);}};
+
+        typedef segment_view<iterator, pointer>             segment_range;
+        typedef segment_view<const_iterator, const_pointer> const_segment_range;
+
+        // --------
+        // segments
+        // --------
+
+        /**
+         * The blocks of [b, e) as (pointer, length) segments.
+         */
+        static segment_range segments (iterator b, iterator e) {
+            return segment_range(b, e);}
+
+        static const_segment_range segments (const_iterator b, const_iterator e) {
+            return const_segment_range(b, e);}
+
+        /**
+         * The blocks of the whole deque as (pointer, length) segments.
+         */
+        segment_range segments () {
+            return segments(begin(), end());}
+
+        const_segment_range segments () const {
+            return segments(begin(), end());}
+
+    public:
+        // --------------------
+        // segmented algorithms
+        // --------------------
+
+        // Overloads of the standard algorithms for my_deque iterators,
+        // found by argument-dependent lookup from unqualified calls
+        // (std::for_each(...) still gets the element-wise version). Each
+        // runs the standard algorithm once per block on raw pointers.
+
+        template <typename F>
+        friend F for_each (iterator b, iterator e, F f) {
+            for (const segment& s : segments(b, e))
+                for (pointer p = s.begin(); p != s.end(); ++p)
+                    f(*p);
+            return f;}
+
+        template <typename F>
+        friend F for_each (const_iterator b, const_iterator e, F f) {
+            for (const const_segment& s : segments(b, e))
+                for (const_pointer p = s.begin(); p != s.end(); ++p)
+                    f(*p);
+            return f;}
+
+        template <typename O>
+        friend O copy (const_iterator b, const_iterator e, O x) {
+            for (const const_segment& s : segments(b, e))
+                x = std::copy(s.begin(), s.end(), x);
+            return x;}
+
+        friend iterator copy (const_iterator b, const_iterator e, iterator x) {
+            return copy_segments(b, e, x);}
+
+        template <typename O>
+        friend O copy (iterator b, iterator e, O x) {
+            return copy(const_iterator(b), const_iterator(e), x);}
+
+        template <typename U>
+        friend void fill (iterator b, iterator e, const U& v) {
+            for (const segment& s : segments(b, e))
+                std::fill(s.begin(), s.end(), v);}
+
+        template <typename U>
+        friend const_iterator find (const_iterator b, const_iterator e, const U& v) {
+            for (const const_segment& s : segments(b, e)) {
+                const const_pointer p = std::find(s.begin(), s.end(), v);
+                if (p != s.end())
+                    return b + (p - s.data);
+                b += s.size;}
+            return e;}
+
+        template <typename U>
+        friend iterator find (iterator b, iterator e, const U& v) {
+            return b + (find(const_iterator(b), const_iterator(e), v) - const_iterator(b));}
+
+        template <typename U>
+        friend difference_type count (const_iterator b, const_iterator e, const U& v) {
+            difference_type n = 0;
+            for (const const_segment& s : segments(b, e))
+                n += std::count(s.begin(), s.end(), v);
+            return n;}
+
+        template <typename U>
+        friend difference_type count (iterator b, iterator e, const U& v) {
+            return count(const_iterator(b), const_iterator(e), v);}
+
+        template <typename U>
+        friend U accumulate (const_iterator b, const_iterator e, U init) {
+            for (const const_segment& s : segments(b, e))
+                init = std::accumulate(s.begin(), s.end(), init);
+            return init;}
+
+        template <typename U>
+        friend U accumulate (iterator b, iterator e, U init) {
+            return accumulate(const_iterator(b), const_iterator(e), init);}
+
+        template <typename U, typename F>
+        friend U accumulate (const_iterator b, const_iterator e, U init, F f) {
+            for (const const_segment& s : segments(b, e))
+                init = std::accumulate(s.begin(), s.end(), init, f);
+            return init;}
+
+        template <typename U, typename F>
+        friend U accumulate (iterator b, iterator e, U init, F f) {
+            return accumulate(const_iterator(b), const_iterator(e), init, f);}
+
+        template <typename I>
+        friend bool equal (const_iterator b, const_iterator e, I x) {
+            return equal_to(b, e, x);}
+
+        template <typename I>
+        friend bool equal (iterator b, iterator e, I x) {
+            return equal_to(b, e, x);}
+
+    private:
+        // --------
+        // equal_to
+        // --------
+
+        /**
+         * equal for a my_deque range against any other range, one block
+         * of the first at a time.
+         */
+        template <typename I>
+        static bool equal_to (const_iterator b, const_iterator e, I x) {
+            for (const const_segment& s : segments(b, e)) {
+                if (!std::equal(s.begin(), s.end(), x))
+                    return false;
+                std::advance(x, s.size);}
+            return true;}
+
+        /**
+         * equal for two my_deque ranges, over runs that are contiguous
+         * in both.
+         */
+        static bool equal_to (const_iterator b, const_iterator e, const_iterator x) {
+            while (b != e) {
+                const difference_type c = std::min(std::min(run(b), run(x)), e - b);
+                if (!std::equal(raw(b), raw(b) + c, raw(x)))
+                    return false;
+                b += c;
+                x += c;}
+            return true;}
+
+        static bool equal_to (const_iterator b, const_iterator e, iterator x) {
+            return equal_to(b, e, const_iterator(x));}
+
+        // ---------
+        // less_than
+        // ---------
+
+        /**
+         * Lexicographical comparison of two deques, over runs that are
+         * contiguous in both.
+         */
+        static bool less_than (const my_deque& lhs, const my_deque& rhs) {
+            const_iterator b = lhs.begin();
+            const_iterator x = rhs.begin();
+            difference_type n = std::min(lhs.size(), rhs.size());
+            while (n != 0) {
+                const difference_type c = std::min(std::min(run(b), run(x)), n);
+                const const_pointer p = raw(b);
+                const const_pointer q = raw(x);
+                for (difference_type i = 0; i != c; ++i) {
+                    if (p[i] < q[i])
+                        return true;
+                    if (q[i] < p[i])
+                        return false;}
+                b += c;
+                x += c;
+                n -= c;}
+            return lhs.size() < rhs.size();}
+
+    private:
+        // -------------
+        // move_segments
+        // -------------
+
+        /**
+         * Move-assigns [b, e) to x, one run of contiguous slots at a time.
+         */
+        static iterator move_segments (iterator b, iterator e, iterator x) {
+            while (b != e) {
+                const difference_type c = std::min(std::min(b._last - b._cur, x._last - x._cur), e - b);
+                std::move(b._cur, b._cur + c, x._cur);
+                b += c;
+                x += c;}
+            return x;}
+
+        // ----------------------
+        // move_backward_segments
+        // ----------------------
+
+        /**
+         * Move-assigns [b, e) to the range ending at x, back to front, one
+         * run of contiguous slots at a time.
+         */
+        static iterator move_backward_segments (iterator b, iterator e, iterator x) {
+            while (b != e) {
+                const iterator el = e - 1;
+                const iterator xl = x - 1;
+                const difference_type c = std::min(std::min((el._cur - el._first) + 1, (xl._cur - xl._first) + 1), e - b);
+                std::move_backward(el._cur + 1 - c, el._cur + 1, xl._cur + 1);
+                e -= c;
+                x -= c;}
+            return x;}
+
+        // --------------
+        // prefetch_block
+        // --------------
+
+        static const size_type prefetch_distance = my_deque_prefetch_distance<T>::value;
+
+        /**
+         * Asks for every cache line of block p, which may be null, to be
+         * loaded.
+         */
+        static void prefetch_block (const_pointer p) {
+            my_deque_prefetch(p, B * sizeof(T));}
+
+        // ---
+        // run
+        // ---
+
+        /**
+         * Number of contiguous slots from i to the end of its block, and
+         * raw(i), a pointer-based iterator over them, so that per-block
+         * copies reach the memcpy/memmove paths.
+         */
+        static difference_type run (const_iterator i) {
+            return i._last - i._cur;}
+
+        static difference_type run (std::move_iterator<iterator> i) {
+            return i.base()._last - i.base()._cur;}
+
+        static const_pointer raw (const_iterator i) {
+            return i._cur;}
+
+        static std::move_iterator<pointer> raw (std::move_iterator<iterator> i) {
+            return std::make_move_iterator(i.base()._cur);}
+
+        // -------------
+        // copy_segments
+        // -------------
+
+        /**
+         * Assigns [b, e) to x, one run of contiguous slots at a time.
+         */
+        template <typename RI>
+        static iterator copy_segments (RI b, RI e, iterator x) {
+            while (b != e) {
+                const difference_type c = std::min(std::min(run(b), x._last - x._cur), e - b);
+                std::copy(raw(b), raw(b) + c, x._cur);
+                b += c;
+                x += c;}
+            return x;}
+
+        // ---------------------------
+        // uninitialized_copy_segments
+        // ---------------------------
+
+        /**
+         * Constructs the n elements starting at b into the raw contiguous
+         * slots at x, one run of contiguous source slots at a time.
+         */
+        template <typename RI>
+        void uninitialized_copy_segments (RI b, size_type n, pointer x) {
+            const pointer p = x;
+            try {
+                while (n != 0) {
+                    const size_type c = std::min<size_type>(run(b), n);
+                    x = uninitialized_copy(_a, raw(b), raw(b) + c, x);
+                    b += c;
+                    n -= c;}}
+            catch (...) {
+                destroy(_a, p, x);
+                throw;}}
+
+        // ---------------------------
+        // uninitialized_move_segments
+        // ---------------------------
+
+        /**
+         * Move-constructs [b, e) into the raw slots at x, one run of
+         * contiguous slots at a time.
+         */
+        iterator uninitialized_move_segments (iterator b, iterator e, iterator x) {
+            const iterator p = x;
+            try {
+                while (b != e) {
+                    const difference_type c = std::min(std::min(b._last - b._cur, x._last - x._cur), e - b);
+                    uninitialized_copy(_a, std::make_move_iterator(b._cur), std::make_move_iterator(b._cur + c), x._cur);
+                    b += c;
+                    x += c;}}
+            catch (...) {
+                destroy(_a, p, x);
+                throw;}
+            return x;}
+
+        // ------------
+        // for_segments
+        // ------------
+
+        /**
+         * Calls f(p, c) for each run of c contiguous slots in the n slots
+         * starting at b.
+         */
+        template <typename F>
+        static void for_segments (iterator b, size_type n, F f) {
+            while (n != 0) {
+                const size_type c = std::min<size_type>(b._last - b._cur, n);
+                f(b._cur, c);
+                b += c;
+                n -= c;}}
+
+        // -----------
+        // copy_source
+        // -----------
+
+        /**
+         * Source for insert_aux that reads from a forward range.
+         */
+        template <typename FI>
+        struct copy_source {
+            FI _i;
+
+            void construct (allocator_type& a, pointer p, size_type c) {
+                FI e = _i;
+                std::advance(e, c);
+                uninitialized_copy(a, _i, e, p);
+                _i = e;}
+
+            void assign (pointer p, size_type c) {
+                for (; c != 0; --c, ++p, ++_i)
+                    *p = *_i;}};
+
+        // -----------
+        // fill_source
+        // -----------
+
+        /**
+         * Source for insert_aux that repeats one value.
+         */
+        struct fill_source {
+            const value_type& _v;
+
+            void construct (allocator_type& a, pointer p, size_type c) {
+                uninitialized_fill(a, p, p + c, _v);}
+
+            void assign (pointer p, size_type c) {
+                std::fill(p, p + c, _v);}};
+
+        // ----------
+        // insert_aux
+        // ----------
+
+        /**
+         * Inserts n elements taken in order from src before position k,
+         * shifting whichever side of k is shorter. Existing elements are
+         * moved into the new raw slots at that end first, the rest of the
+         * side is shifted in bulk, and then the gap is filled, so src is
+         * read exactly once, front to back.
+         */
+        template <typename Src>
+        iterator insert_aux (size_type k, size_type n, Src src) {
+            if (n == 0)
+                return begin() + k;
+            if (k < (size() - k)) {
+                this->on_shift(k);
+                reserve_front(n);
+                const iterator ob = begin();
+                const iterator nb = ob - n;
+                const iterator p  = ob + k;
+                if (k >= n) {
+                    uninitialized_move_segments(ob, ob + n, nb);
+                    _b = nb._node;
+                    _bi = nb._cur;
+                    _start -= n;
+                    _size += n;
+                    move_segments(ob + n, p, ob);
+                    for_segments(p - n, n, [&] (pointer q, size_type c) {src.assign(q, c);});}
+                else {
+                    uninitialized_move_segments(ob, p, nb);
+                    try {
+                        for_segments(nb + k, n - k, [&] (pointer q, size_type c) {src.construct(_a, q, c);});}
+                    catch (...) {
+                        destroy(_a, nb, nb + k);
+                        throw;}
+                    _b = nb._node;
+                    _bi = nb._cur;
+                    _start -= n;
+                    _size += n;
+                    for_segments(ob, k, [&] (pointer q, size_type c) {src.assign(q, c);});}}
+            else {
+                const size_type after = size() - k;
+                this->on_shift(after);
+                reserve_back(n);
+                const iterator oe = end();
+                const iterator p  = begin() + k;
+                if (after > n) {
+                    uninitialized_move_segments(oe - n, oe, oe);
+                    _size += n;
+                    move_backward_segments(p, oe - n, oe);
+                    for_segments(p, n, [&] (pointer q, size_type c) {src.assign(q, c);});}
+                else {
+                    const iterator m = uninitialized_move_segments(p, oe, oe + (n - after));
+                    try {
+                        for_segments(p, after, [&] (pointer q, size_type c) {src.assign(q, c);});
+                        for_segments(oe, n - after, [&] (pointer q, size_type c) {src.construct(_a, q, c);});}
+                    catch (...) {
+                        destroy(_a, oe + (n - after), m);
+                        throw;}
+                    _size += n;}}
+            this->on_grow(_size);
+            assert(valid());
+            return begin() + k;}
+
+        // ------------
+        // insert_range
+        // ------------
+
+        /**
+         * Inserts a forward range, whose length is known up front.
+         */
+        template <typename FI>
+        iterator insert_range (size_type k, FI b, FI e, std::forward_iterator_tag) {
+            const copy_source<FI> src = {b};
+            return insert_aux(k, std::distance(b, e), src);}
+
+        /**
+         * Inserts a single-pass range by buffering it first.
+         */
+        template <typename II>
+        iterator insert_range (size_type k, II b, II e, std::input_iterator_tag) {
+            my_deque x(_a);
+            for (; b != e; ++b)
+                x.emplace_back(*b);
+            return insert_range(k, std::make_move_iterator(x.begin()), std::make_move_iterator(x.end()), std::random_access_iterator_tag());}
+
+        // ------------
+        // append_range
+        // ------------
+
+        /**
+         * Appends a forward range: its length is taken once and each block
+         * is filled by a single uninitialized_copy.
+         */
+        template <typename FI>
+        void append_range (FI b, FI e, std::forward_iterator_tag) {
+            construct_back(std::distance(b, e), [&] (pointer p, size_type k) {
+                FI m = b;
+                std::advance(m, k);
+                uninitialized_copy(_a, b, m, p);
+                b = m;});}
+
+        /**
+         * Appends a single-pass range one element at a time, taking the
+         * elements back off if one of them throws.
+         */
+        template <typename II>
+        void append_range (II b, II e, std::input_iterator_tag) {
+            const size_type s = size();
+            try {
+                for (; b != e; ++b)
+                    emplace_back(*b);}
+            catch (...) {
+                erase(begin() + s, end());
+                throw;}}
+
+        // -------------
+        // prepend_range
+        // -------------
+
+        /**
+         * Prepends a forward range, block by block, as append_range does.
+         */
+        template <typename FI>
+        void prepend_range (FI b, FI e, std::forward_iterator_tag) {
+            construct_front(std::distance(b, e), [&] (pointer p, size_type k) {
+                FI m = b;
+                std::advance(m, k);
+                uninitialized_copy(_a, b, m, p);
+                b = m;});}
+
+        /**
+         * Prepends a single-pass range by buffering it first.
+         */
+        template <typename II>
+        void prepend_range (II b, II e, std::input_iterator_tag) {
+            my_deque x(_a);
+            x.append_range(b, e, std::input_iterator_tag());
+            prepend_range(std::make_move_iterator(x.begin()), std::make_move_iterator(x.end()), std::random_access_iterator_tag());}
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * <your documentation>
+         */
+        explicit my_deque (const allocator_type& a = allocator_type()) : _a(a), _pa(_a) {
+            _bl = _el = _b = 0;
+            _bi = 0;
+            _size = _outer_size = _start = 0;
+            _spares = _allocations = 0;
+            _spare = 0;
+            _spare_max = default_spare_blocks;
+            _auto_shrink = false;
+            assert(valid());}
+
+        /**
+         * <your documentation>
+         */
+        explicit my_deque (size_type s, const_reference v = value_type(), const allocator_type& a = allocator_type()) : _a(a), _pa(_a) {
+            _bl = _el = _b = 0;
+            _bi = 0;
+            _size = _outer_size = _start = 0;
+            _spares = _allocations = 0;
+            _spare = 0;
+            _spare_max = default_spare_blocks;
+            _auto_shrink = false;
+            try {
+                construct_back(s, [&] (pointer p, size_type k) {
+                    uninitialized_fill(_a, p, p + k, v);});}
+            catch (...) {
+                deallocate_map();
+                throw;}
+            assert(valid());}
+
+        /**
+         * <your documentation>
+         */
+        /**
+         * Copies that's elements into new blocks, from the allocator that
+         * select_on_container_copy_construction picks.
+         */
+        my_deque (const my_deque& that) :
+                _a(allocator_traits::select_on_container_copy_construction(that._a)),
+                _pa(_a) {
+            _bl = _el = _b = 0;
+            _bi = 0;
+            _size = _outer_size = _start = 0;
+            _spares = _allocations = 0;
+            _spare = 0;
+            _spare_max = that._spare_max;
+            _auto_shrink = that._auto_shrink;
+            const_iterator b = that.begin();
+            try {
+                construct_back(that.size(), [&] (pointer p, size_type k) {
+                    uninitialized_copy_segments(b, k, p);
+                    b += k;});}
+            catch (...) {
+                deallocate_map();
+                throw;}
+            assert(valid());}
+
+        /**
+         * Takes over that's blocks, and its stats with them; that is left
+         * empty.
+         */
+        my_deque (my_deque&& that) noexcept :
+                S(std::move(that)),
+                _a(std::move(that._a)),
+                _pa(std::move(that._pa)),
+                _bl(that._bl),
+                _el(that._el),
+                _b(that._b),
+                _bi(that._bi),
+                _start(that._start),
+                _size(that._size),
+                _outer_size(that._outer_size),
+                _spare(that._spare),
+                _spares(that._spares),
+                _spare_max(that._spare_max),
+                _allocations(that._allocations),
+                _auto_shrink(that._auto_shrink) {
+            that._bl = that._el = that._b = 0;
+            that._bi = 0;
+            that._size = that._outer_size = that._start = 0;
+            that._spares = that._allocations = 0;
+            that._spare = 0;
+            static_cast<S&>(that) = S();
             assert(valid());}
 
         // ----------
-        // operator =
+        // destructor
         // ----------
 
         /**
          * <your documentation>
          */
+        ~my_deque () {
+            deallocate_map();
+            assert(valid());}
+
+        // ----------
+        // operator =
+        // ----------
+
+        /**
+         * Copy-assigns over the live elements and constructs only the
+         * rest, in the blocks this deque already has. If the allocator
+         * propagates on copy assignment and differs from rhs's, the old
+         * blocks go back to the old allocator first and the copy is made
+         * with rhs's.
+         */
         my_deque& operator = (const my_deque& rhs) {
-            size_type right_capacity;
-
-            if(!empty()){
-                right_capacity = ((_el - _b) * 10) - (_bi - *_b + 1);
-
-                if(this == &rhs){
-                    return *this;
-                }
-                if(size() == rhs.size()){
-                    std::copy(rhs.begin(), rhs.end(), begin());
-                }
-                else if(rhs.size() < size()){
-                    std::copy(rhs.begin(), rhs.end(), begin());
-                    resize(rhs.size());
-                }
-                else if(rhs.size() <= right_capacity){
-                    std::copy(rhs.begin(), rhs.begin() + size(), begin());
-                    uninitialized_copy(_a, rhs.begin() + size(), rhs.end(), end());
-                    _size = rhs.size();
-                }
-                else{
-                    clear();
-                    resize(rhs.size());
-                    uninitialized_copy(_a, rhs.begin(), rhs.end(), begin());
-                }
-            }
-            else{
-                resize(rhs.size());
-                uninitialized_copy(_a, rhs.begin(), rhs.end(), begin());
-            }
+            if (this != &rhs) {
+                typedef typename allocator_traits::propagate_on_container_copy_assignment propagate;
+                if (propagate::value && (_a != rhs._a))
+                    deallocate_map();
+                copy_allocator(rhs._a, propagate());
+                assign(rhs.begin(), rhs.end());}
+            assert(valid());
+            return *this;}
+
+        /**
+         * Takes over rhs's blocks when the allocator propagates on move
+         * assignment (and comes along) or the two are equal; otherwise
+         * move-assigns and move-constructs element by element into this
+         * deque's blocks.
+         */
+        my_deque& operator = (my_deque&& rhs) {
+            if (this != &rhs) {
+                typedef typename allocator_traits::propagate_on_container_move_assignment propagate;
+                if (propagate::value || (_a == rhs._a)) {
+                    deallocate_map();
+                    copy_allocator(rhs._a, propagate());
+                    _spare_max = rhs._spare_max;
+                    _auto_shrink = rhs._auto_shrink;
+                    take(rhs);}
+                else {
+                    assign(std::make_move_iterator(rhs.begin()), std::make_move_iterator(rhs.end()));
+                    rhs.clear();}}
             assert(valid());
             return *this;}
 
@@ -634,25 +2110,13 @@ class my_deque {
         // -----------
 
         /**
-         * <your documentation>
+         * Element index, from the front's absolute slot in the map: one
+         * add, then a divide and a remainder by B, which are a shift and a
+         * mask for the power-of-two block sizes, and no branch.
          */
         reference operator [] (size_type index) {
-            size_type oi = index / 10;
-            size_type ii = index % 10;
-
-            size_type offset = (_bi - *_b);
-
-            if((offset + ii) > 9){
-                pointer* copy = _b + oi + 1;
-                pointer pos = *copy + (offset + ii - 10);
-                return *pos;
-            }
-            else{
-                pointer* copy = _b + oi;
-                pointer pos = *copy + offset + ii;
-                return *pos;
-            }
-        }
+            const size_type k = _start + index;
+            return _bl[k / B][k % B];}
 
         /**
          * <your documentation>
@@ -660,12 +2124,58 @@ class my_deque {
         const_reference operator [] (size_type index) const {
             return const_cast<my_deque*>(this)->operator[](index);}
 
+        // ------
+        // append
+        // ------
+
+        /**
+         * Adds [b, e) after the back, in order. The map grows at most once
+         * and every block is filled in one tight loop, or with one memcpy
+         * when b is a pointer to trivially copyable elements (pass data()
+         * rather than a container iterator to get it). Either the whole
+         * range is added or, if an element throws, nothing is.
+         */
+        template <typename II, typename = typename std::enable_if<!std::is_integral<II>::value>::type>
+        void append (II b, II e) {
+            typedef typename std::iterator_traits<II>::iterator_category category;
+            append_range(b, e, category());
+            assert(valid());}
+
+        /**
+         * Adds n elements after the back, handing f(p, k) each run of k raw
+         * contiguous slots at p, front to back, at most one per block. f
+         * must construct all k elements or throw, having destroyed those
+         * it made; all or nothing, as with append. Meant for filling
+         * blocks straight from a buffer or a file.
+         */
+        template <typename F>
+        void append_blocks (size_type n, F f) {
+            construct_back(n, f);
+            assert(valid());}
+
+        /**
+         * Adds n elements after the back, each constructed from g(), called
+         * n times in order; all or nothing, as with append.
+         */
+        template <typename G>
+        void append_n (size_type n, G g) {
+            construct_back(n, [&] (pointer p, size_type k) {
+                pointer q = p;
+                try {
+                    for (; k != 0; --k, ++q)
+                        _a.construct(q, g());}
+                catch (...) {
+                    destroy(_a, p, q);
+                    throw;}});
+            assert(valid());}
+
         // --
         // at
         // --
 
         /**
-         * <your documentation>
+         * operator [] behind one unsigned compare against size(); throws
+         * std::out_of_range past the back.
          */
         reference at (size_type index) {
             if(index >= size()){
@@ -679,6 +2189,28 @@ class my_deque {
         const_reference at (size_type index) const {
             return const_cast<my_deque*>(this)->at(index);}
 
+        // -----------
+        // auto_shrink
+        // -----------
+
+        /**
+         * Whether the map shrinks by itself after large drains.
+         */
+        bool auto_shrink () const {
+            return _auto_shrink;}
+
+        /**
+         * Turns automatic shrinking on or off. When on, a drain that
+         * leaves the live blocks filling a quarter of the map or less
+         * frees the blocks outside them (beyond the spares) and halves
+         * the map twice over; see shrink_to_fit for doing it by hand.
+         * References stay valid, but iterators do not survive a shrink.
+         */
+        void auto_shrink (bool b) {
+            _auto_shrink = b;
+            auto_shrink_map();
+            assert(valid());}
+
         // ----
         // back
         // ----
@@ -704,13 +2236,24 @@ class my_deque {
          * <your documentation>
          */
         iterator begin () {
-            return iterator(this, 0);}
+            return _b ? iterator(_b, _bi) : iterator();}
 
         /**
          * <your documentation>
          */
         const_iterator begin () const {
-            return const_iterator(this, 0);}
+            return _b ? const_iterator(_b, _bi) : const_iterator();}
+
+        // -----------------
+        // block_allocations
+        // -----------------
+
+        /**
+         * Number of blocks this deque has obtained from its allocator so
+         * far; a steady-state workload should leave it unchanged.
+         */
+        size_type block_allocations () const {
+            return _allocations;}
 
         // -----
         // clear
@@ -723,6 +2266,48 @@ class my_deque {
             resize(0);
             assert(valid());}
 
+        // -------
+        // emplace
+        // -------
+
+        /**
+         * Constructs a new back element in place from args.
+         */
+        template <typename... Args>
+        void emplace_back (Args&&... args) {
+            size_type e = front_offset() + size();
+            if ((e / B) == _outer_size) {
+                reserve_map(0, 1);
+                e = front_offset() + size();}
+            pointer* n = _bl + (e / B);
+            if (!*n)
+                *n = allocate_block();
+            _a.construct(*n + (e % B), std::forward<Args>(args)...);
+            ++_size;
+            this->on_grow(_size);
+            assert(valid());}
+
+        /**
+         * Constructs a new front element in place from args.
+         */
+        template <typename... Args>
+        void emplace_front (Args&&... args) {
+            size_type f = front_offset();
+            if (f == 0) {
+                reserve_map(1, 0);
+                f = front_offset();}
+            pointer* n = _bl + ((f - 1) / B);
+            if (!*n)
+                *n = allocate_block();
+            pointer p = *n + ((f - 1) % B);
+            _a.construct(p, std::forward<Args>(args)...);
+            _b = n;
+            _bi = p;
+            _start = f - 1;
+            ++_size;
+            this->on_grow(_size);
+            assert(valid());}
+
         // -----
         // empty
         // -----
@@ -741,13 +2326,13 @@ class my_deque {
          * <your documentation>
          */
         iterator end () {
-            return iterator(this, (this)->size());}
+            return begin() + size();}
 
         /**
          * <your documentation>
          */
         const_iterator end () const {
-            return const_iterator(this, (this)->size());}
+            return begin() + size();}
 
         // -----
         // erase
@@ -757,16 +2342,38 @@ class my_deque {
          * <your documentation>
          */
         iterator erase (iterator i) {
-            iterator e = end() - 1;
-            iterator copy = i;
-            while(copy != e){
-                *copy = *(copy + 1);
-                ++copy;
-            }
-            destroy(_a, copy, copy + 1);
-            --_size;
+            return erase(i, i + 1);}
+
+        /**
+         * Erases [b, e) by shifting whichever side of the gap is shorter,
+         * one run of contiguous slots at a time.
+         */
+        iterator erase (iterator b, iterator e) {
+            const size_type n      = e - b;
+            const size_type before = b - begin();
+            if (n == 0)
+                return b;
+            if (before < (size() - before - n)) {
+                this->on_shift(before);
+                move_backward_segments(begin(), b, e);
+                destroy(_a, begin(), begin() + n);
+                pointer* const ob = _b;
+                const iterator nb = begin() + n;
+                _b = nb._node;
+                _bi = nb._cur;
+                _start += n;
+                _size -= n;
+                release_blocks(ob, _b);}
+            else {
+                this->on_shift(size() - before - n);
+                move_segments(e, end(), b);
+                destroy(_a, end() - n, end());
+                pointer* const ol = live_end();
+                _size -= n;
+                release_blocks(live_end(), ol);}
+            auto_shrink_map();
             assert(valid());
-            return i;}
+            return begin() + before;}
 
         // -----
         // front
@@ -785,6 +2392,13 @@ class my_deque {
         const_reference front () const {
             return const_cast<my_deque*>(this)->front();}
 
+        // -------------
+        // get_allocator
+        // -------------
+
+        allocator_type get_allocator () const {
+            return _a;}
+
         // ------
         // insert
         // ------
@@ -793,32 +2407,69 @@ class my_deque {
          * <your documentation>
          */
         iterator insert (iterator i, const_reference v) {
-            if(_outer_size == 0){
-                resize(1);
-                *(begin()) = v;
-                return begin();
-            }
-            else if(empty()){
-                *(begin()) = v;
-                ++_size;
-                return begin();
-            }
-            else{
-                size_type right_capacity = ((_el - _b) * 10) - (_bi - *_b + 1);
-                if(size() == right_capacity){
-                    resize(size() + 1);
-                }
-                iterator e = end();
-                while(i != e){
-                    *e = *(e - 1);
-                    --e;
-                }
-                *i = v;
-                ++_size;
-            }
+            value_type x(v); // v may refer into *this
+            return insert(i, std::move(x));}
+
+        /**
+         * Inserts v before i by moving it in.
+         */
+        iterator insert (iterator i, value_type&& v) {
+            const size_type k = i - begin();
+            if (k < (size() - k)) {
+                if (k == 0) {
+                    emplace_front(std::move(v));
+                    return begin();}
+                emplace_front(std::move(front()));
+                this->on_shift(k);
+                i = begin() + k;
+                move_segments(begin() + 2, i + 1, begin() + 1);}
+            else {
+                if (k == size()) {
+                    emplace_back(std::move(v));
+                    return end() - 1;}
+                emplace_back(std::move(back()));
+                this->on_shift(size() - k - 1);
+                i = begin() + k;
+                move_backward_segments(i, end() - 2, end() - 1);}
+            *i = std::move(v);
             assert(valid());
             return i;}
 
+        /**
+         * Inserts n copies of v before i.
+         */
+        iterator insert (iterator i, size_type n, const_reference v) {
+            const value_type x(v); // v may refer into *this
+            const fill_source src = {x};
+            return insert_aux(i - begin(), n, src);}
+
+        /**
+         * Inserts [b, e) before i, which must not point into *this.
+         */
+        template <typename II, typename = typename std::enable_if<!std::is_integral<II>::value>::type>
+        iterator insert (iterator i, II b, II e) {
+            typedef typename std::iterator_traits<II>::iterator_category category;
+            return insert_range(i - begin(), b, e, category());}
+
+        // ----------------
+        // max_spare_blocks
+        // ----------------
+
+        /**
+         * Most drained blocks kept for reuse by the next pushes at either
+         * end; blocks drained beyond that go back to the allocator.
+         */
+        size_type max_spare_blocks () const {
+            return _spare_max;}
+
+        /**
+         * Sets the spare limit to n, freeing any spares above it.
+         */
+        void max_spare_blocks (size_type n) {
+            _spare_max = n;
+            trim_spares(n);
+            assert(valid());}
+
         // ---
         // pop
         // ---
@@ -828,7 +2479,12 @@ class my_deque {
          */
         void pop_back () {
             assert(!empty());
-            resize(size() - 1);
+            destroy(_a, end() - 1, end());
+            pointer* const ol = live_end();
+            --_size;
+            if (live_end() != ol) {
+                release_blocks(live_end(), ol);
+                auto_shrink_map();}
             assert(valid());}
 
         /**
@@ -837,14 +2493,37 @@ class my_deque {
         void pop_front () {
             assert(!empty());
             destroy(_a, begin(), begin() + 1);
-            if((*_b + 9) == _bi){
+            --_size;
+            if((*_b + (B - 1)) != _bi){
+                ++_bi;
+                ++_start;
+            }
+            else if(!empty()){
                 ++_b;
                 _bi = *(_b);
+                ++_start;
+                release_block(_b - 1);
+                auto_shrink_map();
             }
             else{
-                ++_bi;
+                _bi = *_b; // drained: restart at the top of the same block
+                _start -= B - 1;
             }
-            --_size;
+            assert(valid());}
+
+        // -------
+        // prepend
+        // -------
+
+        /**
+         * Adds [b, e) before the front, keeping its order, so that *b
+         * becomes the new front; block by block and all or nothing, as
+         * with append.
+         */
+        template <typename II, typename = typename std::enable_if<!std::is_integral<II>::value>::type>
+        void prepend (II b, II e) {
+            typedef typename std::iterator_traits<II>::iterator_category category;
+            prepend_range(b, e, category());
             assert(valid());}
 
         // ----
@@ -855,47 +2534,47 @@ class my_deque {
          * <your documentation>
          */
         void push_back (const_reference v) {
-            if(empty()){
-                my_deque x(1, v);
-                swap(x);
-            }
-            else{
-                resize(size() + 1, v);
-            }
-            assert(valid());}
+            emplace_back(v);}
+
+        /**
+         * Moves v in at the back.
+         */
+        void push_back (value_type&& v) {
+            emplace_back(std::move(v));}
 
         /**
          * <your documentation>
          */
         void push_front (const_reference v) {
-            if(empty()){
-                my_deque x(1, v);
-                swap(x);
-            }
-            else{
-                if((*_bl) == _bi){
-                    size_type remember = _size;
-                    my_deque x((_outer_size * 10) * 3);
-                    swap(x);
-                    uninitialized_copy(_a, x.begin(), x.end(), begin() + (x._outer_size * 10));
-
-                    _b = _bl + (x._outer_size) - 1;
-                    _bi = *_b + 9;
-                    uninitialized_fill(_a, begin(), begin() + 1, v);
-                    _size = remember + 1;
-                }
-                else if((*_b) == _bi){
-                    --_b;
-                    _bi = *_b + 9;
-                    uninitialized_fill(_a, begin(), begin() + 1, v);
-                    ++_size;
-                }
-                else{
-                    --_bi;
-                    uninitialized_fill(_a, begin(), begin() + 1, v);
-                    ++_size;
-                }
-            }
+            emplace_front(v);}
+
+        /**
+         * Moves v in at the front.
+         */
+        void push_front (value_type&& v) {
+            emplace_front(std::move(v));}
+
+        // -------
+        // reserve
+        // -------
+
+        /**
+         * Makes room for n more elements after the back, blocks included,
+         * so the next n push_backs won't allocate.
+         */
+        void reserve_back (size_type n) {
+            reserve_map(0, n);
+            const size_type e = front_offset() + size();
+            allocate_blocks(_bl + (e / B), _bl + ((e + n + B - 1) / B));
+            assert(valid());}
+
+        /**
+         * Makes room for n more elements before the front, blocks included,
+         * so the next n push_fronts won't allocate.
+         */
+        void reserve_front (size_type n) {
+            reserve_map(n, 0);
+            allocate_blocks(_bl + ((front_offset() - n) / B), _b);
             assert(valid());}
 
         // ------
@@ -906,59 +2585,32 @@ class my_deque {
          * <your documentation>
          */
         void resize (size_type s, const_reference v = value_type()) {
-            size_type right_capacity;
-
-            if(s == size()){
-                return;
-            }
-            else if(s == 0){
-                destroy(_a, begin(), end());
-                _size = 0;
-            }
-            else if(empty()){
-                my_deque x(s, v);
-                swap(x);
-            }
-            else if(s < size()){
+            if (s < size()) {
                 destroy(_a, begin() + s, end());
+                pointer* const ol = live_end();
                 _size = s;
-            }
-            else{
-                right_capacity = ((_el - _b) * 10) - (_bi - *_b + 1);
-                if(s < right_capacity){
-                    uninitialized_fill(_a, end(), begin() + s, v);
-                    _size = s;
-                }
-                else{
-                    if((s - (right_capacity)) < (_outer_size * 10)){
-                        my_deque x((_outer_size * 10) * 3);
-                        swap(x);
-                        size_type new_bi = ((2 * (x._outer_size * 10)) - right_capacity);
-                        uninitialized_copy(_a, x.begin(), x.end(), begin() + new_bi);
-                        _size = x.size();
-
-                        _b = _bl + ((x._outer_size) + (x._b - x._bl));
-                        _bi = *_b + (x._bi - *(x._b));
-
-                        resize(s , v);
-                    }
-                    else{
-                        size_type new_size = ((s / 10) + 1) * 10;
-
-                        my_deque x((_outer_size * 10) + (2 * new_size));
-                        swap(x);
-                        size_type new_bi = (new_size + (x._outer_size * 10) - right_capacity);
-                        uninitialized_copy(_a, x.begin(), x.end(), begin() + new_bi);
-                        _size = x.size();
-
-                        _b = _bl + ((new_size / 10) + (x._b - x._bl));
-                        _bi = *_b + (x._bi - *(x._b));
-
-                        resize(s, v);
-                    }
-                }
-            }
+                release_blocks(live_end(), ol);
+                auto_shrink_map();}
+            else if (s > size())
+                construct_back(s - size(), [&] (pointer p, size_type k) {
+                    uninitialized_fill(_a, p, p + k, v);});
+            assert(valid());}
 
+        // -------------
+        // shrink_to_fit
+        // -------------
+
+        /**
+         * Frees every block that holds no element, spares included, and
+         * shrinks the map to the live blocks; an empty deque lets go of
+         * all its memory. References to elements stay valid.
+         */
+        void shrink_to_fit () {
+            if (empty())
+                deallocate_map();
+            else {
+                shrink_map(0);
+                trim_spares(0);}
             assert(valid());}
 
         // ----
@@ -971,27 +2623,62 @@ class my_deque {
         size_type size () const {
             return _size;}
 
+        // ------------
+        // spare_blocks
+        // ------------
+
+        /**
+         * Number of drained blocks held for reuse.
+         */
+        size_type spare_blocks () const {
+            return _spares;}
+
+        // -----
+        // stats
+        // -----
+
+        /**
+         * A copy of the stats policy's counts, with the bytes of unused
+         * slots in the first and last live blocks filled in. The counts
+         * follow the blocks: a move or a swap takes them along, a copy
+         * starts from zero.
+         */
+        stats_type stats () const {
+            stats_type s(*this);
+            s.on_sample(_b ? ((((live_end() - _b) * B) - size()) * sizeof(value_type)) : 0);
+            return s;}
+
         // ----
         // swap
         // ----
 
         /**
-         * <your documentation>
+         * Exchanges the blocks, and the allocators too if they propagate
+         * on swap. Unequal allocators that don't propagate can't free each
+         * other's blocks, so then the elements are moved across instead,
+         * in linear time (the standard leaves that case undefined).
          */
         void swap (my_deque& that) {
-            if(_a == that._a){
+            typedef typename allocator_traits::propagate_on_container_swap propagate;
+            if (propagate::value || (_a == that._a)) {
+                swap_allocator(that, propagate());
                 std::swap(_b, that._b);
                 std::swap(_bl, that._bl);
                 std::swap(_el, that._el);
                 std::swap(_bi, that._bi);
+                std::swap(_start, that._start);
                 std::swap(_size, that._size);
                 std::swap(_outer_size, that._outer_size);
-            }
-            else{
-                my_deque x(*this);
-                *this = that;
-                that = x;
-            }
+                std::swap(_spare, that._spare);
+                std::swap(_spares, that._spares);
+                std::swap(_spare_max, that._spare_max);
+                std::swap(_allocations, that._allocations);
+                std::swap(_auto_shrink, that._auto_shrink);
+                std::swap(static_cast<S&>(*this), static_cast<S&>(that));}
+            else {
+                my_deque x(std::move(*this));
+                *this = std::move(that);
+                that = std::move(x);}
             assert(valid());}};
 
 #endif // Deque_h
@@ -0,0 +1,309 @@
+// ------------------------
+// projects/deque/DequeIO.h
+// Copyright (C) 2014
+// Glenn P. Downing
+// ------------------------
+
+#ifndef DequeIO_h
+#define DequeIO_h
+
+// --------
+// includes
+// --------
+
+#include <algorithm>    // min
+#include <cerrno>       // EINTR, errno
+#include <cstddef>      // size_t
+#include <cstdint>      // uint32_t, uint64_t
+#include <cstring>      // memcmp, memcpy
+#include <stdexcept>    // runtime_error
+#include <system_error> // generic_category, system_error
+#include <type_traits>  // is_trivially_copyable
+#include <vector>       // vector
+
+#include <limits.h>     // IOV_MAX
+#include <sys/uio.h>    // iovec, readv, writev
+#include <unistd.h>     // read
+
+#include "Deque.h"
+
+// ------------
+// deque_header
+// ------------
+
+/**
+ * The 24 bytes in front of a serialized deque: the magic "MYDQSER\0",
+ * the format version, sizeof(T) and the element count, in the writer's
+ * byte order. The elements follow as raw bytes, front to back.
+ */
+struct deque_header {
+    static const std::uint32_t version = 1;
+    static const std::size_t   bytes   = 24;
+
+    std::uint32_t value_size;
+    std::uint64_t count;
+
+    /**
+     * Writes the header into p.
+     */
+    void encode (char* p) const {
+        const std::uint32_t v = version;
+        std::memcpy(p,      "MYDQSER", 8);
+        std::memcpy(p + 8,  &v,          4);
+        std::memcpy(p + 12, &value_size, 4);
+        std::memcpy(p + 16, &count,      8);}
+
+    /**
+     * Reads the header from p; throws std::runtime_error if it is not
+     * one, or is for another version or element size.
+     */
+    void decode (const char* p, std::size_t expected_size) {
+        std::uint32_t v;
+        std::memcpy(&v,          p + 8,  4);
+        std::memcpy(&value_size, p + 12, 4);
+        std::memcpy(&count,      p + 16, 8);
+        if (std::memcmp(p, "MYDQSER", 8) != 0)
+            throw std::runtime_error("deque: not a serialized deque");
+        if (v != version)
+            throw std::runtime_error("deque: unsupported format version");
+        if (value_size != expected_size)
+            throw std::runtime_error("deque: element size mismatch");}};
+
+// ----------
+// io_vectors
+// ----------
+
+/**
+ * Moves all of v through readv or writev (f), resuming after short
+ * transfers and EINTR, IOV_MAX vectors at a time; returns the bytes
+ * moved, which is less than asked only at end of file.
+ */
+template <typename F>
+std::size_t io_vectors (int fd, std::vector<iovec>& v, F f, const char* what) {
+    std::size_t total = 0;
+    std::size_t i     = 0;
+    while (i != v.size()) {
+        const int n = static_cast<int>(std::min<std::size_t>(v.size() - i, IOV_MAX));
+        const ssize_t r = f(fd, &v[i], n);
+        if (r < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), what);}
+        if (r == 0)
+            break;
+        total += r;
+        std::size_t k = r;
+        while ((i != v.size()) && (k >= v[i].iov_len))
+            k -= v[i++].iov_len;
+        if (k != 0) {
+            v[i].iov_base = static_cast<char*>(v[i].iov_base) + k;
+            v[i].iov_len -= k;}}
+    return total;}
+
+// -----------
+// write_deque
+// -----------
+
+/**
+ * Writes x to fd: the header, then the live part of each block, all in
+ * writev calls straight from the blocks.
+ */
+template <typename T, typename A, std::size_t B, typename S>
+void write_deque (int fd, const my_deque<T, A, B, S>& x) {
+    static_assert(std::is_trivially_copyable<T>::value, "write_deque needs a trivially copyable T");
+    typedef my_deque<T, A, B, S> deque_type;
+    char h[deque_header::bytes];
+    deque_header d = {sizeof(T), x.size()};
+    d.encode(h);
+    std::vector<iovec> v(1);
+    v[0].iov_base = h;
+    v[0].iov_len  = sizeof(h);
+    for (const typename deque_type::const_segment& s : x.segments()) {
+        iovec e;
+        e.iov_base = const_cast<T*>(s.data);
+        e.iov_len  = s.size * sizeof(T);
+        v.push_back(e);}
+    io_vectors(fd, v, ::writev, "write_deque: writev");}
+
+// ----------
+// read_deque
+// ----------
+
+/**
+ * Appends the deque serialized on fd to x: its blocks are allocated
+ * first and then filled by readv, with no per-element work. Throws
+ * std::runtime_error on a bad header or short payload, leaving x as it
+ * was, and std::system_error if a read fails.
+ */
+template <typename T, typename A, std::size_t B, typename S>
+void read_deque (int fd, my_deque<T, A, B, S>& x) {
+    static_assert(std::is_trivially_copyable<T>::value, "read_deque needs a trivially copyable T");
+    char h[deque_header::bytes];
+    std::vector<iovec> v(1);
+    v[0].iov_base = h;
+    v[0].iov_len  = sizeof(h);
+    if (io_vectors(fd, v, ::readv, "read_deque: read") != sizeof(h))
+        throw std::runtime_error("read_deque: truncated header");
+    deque_header d;
+    d.decode(h, sizeof(T));
+    const std::size_t s = x.size();
+    v.clear();
+    x.append_blocks(d.count, [&v] (T* p, std::size_t k) {
+        iovec e;
+        e.iov_base = p;
+        e.iov_len  = k * sizeof(T);
+        v.push_back(e);});
+    try {
+        if (io_vectors(fd, v, ::readv, "read_deque: readv") != (d.count * sizeof(T)))
+            throw std::runtime_error("read_deque: truncated payload");}
+    catch (...) {
+        x.erase(x.begin() + s, x.end());
+        throw;}}
+
+// -------------
+// deque_decoder
+// -------------
+
+/**
+ * Incremental reader of a serialized deque for payloads that arrive in
+ * pieces: each piece's complete elements are appended to deque() at
+ * once, so the consumer can work on front() and pop_front() while the
+ * rest is still on its way.
+ */
+template <typename T, typename A = std::allocator<T>, std::size_t B = my_deque_block_size<T>::value>
+class deque_decoder {
+    static_assert(std::is_trivially_copyable<T>::value, "deque_decoder needs a trivially copyable T");
+
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef my_deque<T, A, B>              deque_type;
+        typedef typename deque_type::size_type size_type;
+
+    private:
+        // ----
+        // data
+        // ----
+
+        deque_type   _x;
+        char         _h[deque_header::bytes];
+        size_type    _hn;           // header bytes seen
+        char         _e[sizeof(T)];
+        size_type    _en;           // bytes of a split element seen
+        deque_header _d;
+        size_type    _received;     // elements decoded
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        explicit deque_decoder (const A& a = A()) :
+                _x        (a),
+                _hn       (0),
+                _en       (0),
+                _received (0) {
+            _d.value_size = sizeof(T);
+            _d.count      = 0;}
+
+        // -----
+        // deque
+        // -----
+
+        /**
+         * The elements decoded so far and not yet popped by the caller.
+         */
+        deque_type& deque () {
+            return _x;}
+
+        // ----
+        // done
+        // ----
+
+        /**
+         * True once the header and every element it announced are in.
+         */
+        bool done () const {
+            return (_hn == deque_header::bytes) && (_received == _d.count);}
+
+        // --------
+        // expected
+        // --------
+
+        /**
+         * Element count from the header, 0 until the header is in.
+         */
+        size_type expected () const {
+            return _d.count;}
+
+        // ----
+        // feed
+        // ----
+
+        /**
+         * Takes the next n bytes of the payload; throws std::runtime_error
+         * on a bad header or on bytes past the end of the payload.
+         */
+        void feed (const void* data, size_type n) {
+            const char* p = static_cast<const char*>(data);
+            if (_hn != deque_header::bytes) {
+                const size_type k = std::min(n, deque_header::bytes - _hn);
+                std::memcpy(_h + _hn, p, k);
+                _hn += k;
+                p   += k;
+                n   -= k;
+                if (_hn != deque_header::bytes)
+                    return;
+                _d.decode(_h, sizeof(T));}
+            if (n > (((_d.count - _received) * sizeof(T)) - _en))
+                throw std::runtime_error("deque_decoder: bytes past the end of the payload");
+            if (_en != 0) {
+                const size_type k = std::min(n, sizeof(T) - _en);
+                std::memcpy(_e + _en, p, k);
+                _en += k;
+                p   += k;
+                n   -= k;
+                if (_en != sizeof(T))
+                    return;
+                const char* e = _e;
+                _x.append_blocks(1, [e] (T* q, size_type) {
+                    std::memcpy(static_cast<void*>(q), e, sizeof(T));});
+                _en = 0;
+                ++_received;}
+            const size_type c = n / sizeof(T);
+            _x.append_blocks(c, [&p] (T* q, size_type k) {
+                std::memcpy(static_cast<void*>(q), p, k * sizeof(T));
+                p += k * sizeof(T);});
+            _received += c;
+            _en = n % sizeof(T);
+            std::memcpy(_e, p, _en);}
+
+        // ---------
+        // read_some
+        // ---------
+
+        /**
+         * Feeds whatever one read of up to n bytes from fd returns, never
+         * reading past the end of the payload; false at end of file or
+         * once the payload is complete.
+         */
+        bool read_some (int fd, size_type n = 1 << 16) {
+            if (_hn != deque_header::bytes)
+                n = std::min(n, deque_header::bytes - _hn);
+            else
+                n = std::min(n, ((_d.count - _received) * sizeof(T)) - _en);
+            if (n == 0)
+                return false;
+            std::vector<char> b(n);
+            ssize_t r;
+            do {
+                r = ::read(fd, b.data(), n);}
+            while ((r < 0) && (errno == EINTR));
+            if (r < 0)
+                throw std::system_error(errno, std::generic_category(), "deque_decoder: read");
+            feed(b.data(), r);
+            return r != 0;}};
+
+#endif // DequeIO_h
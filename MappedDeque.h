@@ -0,0 +1,457 @@
+// ----------------------------
+// projects/deque/MappedDeque.h
+// Copyright (C) 2014
+// Glenn P. Downing
+// ----------------------------
+
+#ifndef MappedDeque_h
+#define MappedDeque_h
+
+// --------
+// includes
+// --------
+
+#include <algorithm>    // max
+#include <cassert>      // assert
+#include <cerrno>       // errno
+#include <cstddef>      // size_t
+#include <cstdint>      // uint64_t
+#include <cstring>      // memcpy, memmove, memset, strncmp
+#include <stdexcept>    // invalid_argument, out_of_range
+#include <string>       // string
+#include <system_error> // generic_category, system_error
+#include <type_traits>  // is_trivially_copyable
+
+#include <fcntl.h>      // open, O_CREAT, O_RDWR
+#include <sys/mman.h>   // mmap, msync, munmap
+#include <sys/stat.h>   // fstat
+#include <unistd.h>     // close, ftruncate
+
+#include "Deque.h"
+
+// ------------
+// mapped_deque
+// ------------
+
+/**
+ * Deque of trivially copyable T kept in a memory-mapped file, for data
+ * sets bigger than memory or that must survive the process. The layout
+ * follows my_deque: blocks of B elements reached through a map of block
+ * slots, except that blocks and map live in the file and are named by
+ * file offsets instead of pointers. A header page holds the map's place
+ * and the front and size, so opening an existing file costs one mmap:
+ * nothing is read or constructed up front, and pages come in as they
+ * are touched.
+ *
+ * Growing at either end takes blocks from a free list of drained blocks
+ * or from the end of the file, which is extended (doubled) as needed.
+ * Extending remaps the file, so references to elements are good only
+ * until the next push. Changes reach the file through the shared
+ * mapping; flush forces them to disk. A file is only readable by a
+ * build with the same T size, B and byte order.
+ */
+template <typename T, std::size_t B = my_deque_block_size<T>::value>
+class mapped_deque {
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef T                value_type;
+
+        typedef std::size_t      size_type;
+        typedef std::ptrdiff_t   difference_type;
+
+        typedef T*               pointer;
+        typedef const T*         const_pointer;
+
+        typedef T&               reference;
+        typedef const T&         const_reference;
+
+        // ---------
+        // constants
+        // ---------
+
+        static const size_type block_size = B;
+
+        static_assert(std::is_trivially_copyable<T>::value, "mapped_deque needs a trivially copyable T");
+        static_assert((B * sizeof(T)) >= sizeof(std::uint64_t), "mapped_deque blocks must hold a free-list link");
+
+    private:
+        typedef std::uint64_t offset;
+
+        // ------
+        // header
+        // ------
+
+        /**
+         * The first page of the file. Offsets are from the start of the
+         * file; 0 means none.
+         */
+        struct header {
+            char   magic[8];
+            offset value_size;
+            offset block_size;
+            offset top;             // end of the space handed out so far
+            offset map;             // the map: map_capacity block offsets
+            offset map_capacity;
+            offset first;           // map slot of the front block
+            offset blocks;          // live blocks, from first on
+            offset front;           // index of the front in its block
+            offset size;
+            offset free;};          // first drained block, linked through its first bytes
+
+        static const size_type header_bytes = 4096;
+        static const size_type block_bytes  = B * sizeof(T);
+        static const size_type align        = 64;
+
+        // ----
+        // data
+        // ----
+
+        std::string _path;
+        int         _fd;
+        char*       _base;
+        size_type   _bytes;
+
+        // ------
+        // access
+        // ------
+
+        header& h () const {
+            return *reinterpret_cast<header*>(_base);}
+
+        offset* slots () const {
+            return reinterpret_cast<offset*>(_base + h().map);}
+
+        pointer block (offset o) const {
+            return reinterpret_cast<pointer>(_base + o);}
+
+        // ----
+        // fail
+        // ----
+
+        void fail (const char* what) const {
+            throw std::system_error(errno, std::generic_category(), "mapped_deque: " + std::string(what) + " " + _path);}
+
+        // -----
+        // remap
+        // -----
+
+        /**
+         * Sets the file to n bytes and maps all of it.
+         */
+        void remap (size_type n) {
+            if (_base)
+                munmap(_base, _bytes);
+            _base = 0;
+            if ((n != _bytes) && (ftruncate(_fd, n) != 0))
+                fail("ftruncate");
+            void* const p = mmap(0, n, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+            if (p == MAP_FAILED)
+                fail("mmap");
+            _base  = static_cast<char*>(p);
+            _bytes = n;}
+
+        // --------
+        // allocate
+        // --------
+
+        /**
+         * Hands out n bytes at the end of the used space, extending the
+         * file if they are past its end.
+         */
+        offset allocate (size_type n) {
+            const offset o = h().top;
+            const size_type e = o + (((n + align - 1) / align) * align);
+            if (e > _bytes)
+                remap(std::max(2 * _bytes, e));
+            h().top = e;
+            return o;}
+
+        // --------------
+        // allocate_block
+        // --------------
+
+        offset allocate_block () {
+            const offset o = h().free;
+            if (!o)
+                return allocate(block_bytes);
+            std::memcpy(&h().free, block(o), sizeof(offset));
+            return o;}
+
+        // -------------
+        // release_block
+        // -------------
+
+        void release_block (offset o) {
+            std::memcpy(block(o), &h().free, sizeof(offset));
+            h().free = o;}
+
+        // -----------
+        // reserve_map
+        // -----------
+
+        /**
+         * Makes sure the map has a free slot before the front block
+         * (front) or after the back block (!front): recentres the live
+         * slots if the map is at most half full, otherwise moves them to
+         * a new map twice as big; the old map's space is not reused.
+         */
+        void reserve_map (bool front) {
+            const offset f = h().first;
+            const offset n = h().blocks;
+            const offset c = h().map_capacity;
+            if (front ? (f != 0) : ((f + n) != c))
+                return;
+            if ((2 * (n + 1)) <= c) {
+                const offset nf = (c - n) / 2;
+                std::memmove(slots() + nf, slots() + f, n * sizeof(offset));
+                h().first = nf;}
+            else {
+                const offset nc = (2 * c) + 2;
+                const offset m  = allocate(nc * sizeof(offset));
+                const offset nf = (nc - n) / 2;
+                std::memcpy(_base + m + (nf * sizeof(offset)), slots() + f, n * sizeof(offset));
+                h().map          = m;
+                h().map_capacity = nc;
+                h().first        = nf;}}
+
+        // ----
+        // init
+        // ----
+
+        /**
+         * Lays out an empty deque in a new file.
+         */
+        void init () {
+            const size_type c = 64;
+            remap(header_bytes + (c * sizeof(offset)) + (16 * block_bytes));
+            std::memset(_base, 0, header_bytes);
+            std::memcpy(h().magic, "MYDEQUE1", 8);
+            h().value_size   = sizeof(T);
+            h().block_size   = B;
+            h().top          = header_bytes;
+            const offset m   = allocate(c * sizeof(offset));
+            h().map          = m;
+            h().map_capacity = c;
+            h().first        = c / 2;}
+
+        // -----
+        // valid
+        // -----
+
+        bool valid () const {
+            const header& x = h();
+            return (x.first + x.blocks <= x.map_capacity) &&
+                   (x.blocks == (x.size ? ((x.front + x.size + B - 1) / B) : 0)) &&
+                   (x.front < B) && (x.top <= _bytes);}
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * Opens the deque stored at path, or makes an empty one there if
+         * the file does not exist or is empty. Throws std::system_error if
+         * the file can't be opened or mapped, std::invalid_argument if it
+         * holds something else.
+         */
+        explicit mapped_deque (const std::string& path) :
+                _path  (path),
+                _fd    (-1),
+                _base  (0),
+                _bytes (0) {
+            _fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            if (_fd < 0)
+                fail("open");
+            try {
+                struct stat s;
+                if (fstat(_fd, &s) != 0)
+                    fail("fstat");
+                if (s.st_size == 0)
+                    init();
+                else {
+                    _bytes = s.st_size;
+                    remap(_bytes);
+                    if ((_bytes < header_bytes) ||
+                        (std::strncmp(h().magic, "MYDEQUE1", 8) != 0) ||
+                        (h().value_size != sizeof(T)) || (h().block_size != B) || (h().top > _bytes))
+                        throw std::invalid_argument("mapped_deque: not a deque of this type: " + path);}}
+            catch (...) {
+                if (_base)
+                    munmap(_base, _bytes);
+                ::close(_fd);
+                throw;}
+            assert(valid());}
+
+        mapped_deque             (const mapped_deque&) = delete;
+        mapped_deque& operator = (const mapped_deque&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+        /**
+         * Unmaps the file, leaving the deque in it; the kernel writes the
+         * dirty pages back in its own time unless flush was called.
+         */
+        ~mapped_deque () {
+            munmap(_base, _bytes);
+            ::close(_fd);}
+
+        // -----------
+        // operator []
+        // -----------
+
+        reference operator [] (size_type i) {
+            const size_type k = h().front + i;
+            return block(slots()[h().first + (k / B)])[k % B];}
+
+        const_reference operator [] (size_type i) const {
+            return const_cast<mapped_deque*>(this)->operator[](i);}
+
+        // --
+        // at
+        // --
+
+        reference at (size_type i) {
+            if (i >= size())
+                throw std::out_of_range("mapped_deque");
+            return (*this)[i];}
+
+        const_reference at (size_type i) const {
+            return const_cast<mapped_deque*>(this)->at(i);}
+
+        // ----
+        // back
+        // ----
+
+        reference back () {
+            assert(!empty());
+            return (*this)[size() - 1];}
+
+        const_reference back () const {
+            return const_cast<mapped_deque*>(this)->back();}
+
+        // -----
+        // bytes
+        // -----
+
+        /**
+         * Size of the file.
+         */
+        size_type bytes () const {
+            return _bytes;}
+
+        // -----
+        // clear
+        // -----
+
+        /**
+         * Removes every element; their blocks go on the free list.
+         */
+        void clear () {
+            while (h().blocks != 0) {
+                release_block(slots()[h().first]);
+                ++h().first;
+                --h().blocks;}
+            h().front = 0;
+            h().size  = 0;
+            assert(valid());}
+
+        // -----
+        // empty
+        // -----
+
+        bool empty () const {
+            return size() == 0;}
+
+        // -----
+        // flush
+        // -----
+
+        /**
+         * Writes the changes out to the file: waits for the disk if sync,
+         * only schedules the writes otherwise.
+         */
+        void flush (bool sync = true) {
+            if (msync(_base, _bytes, sync ? MS_SYNC : MS_ASYNC) != 0)
+                fail("msync");}
+
+        // -----
+        // front
+        // -----
+
+        reference front () {
+            assert(!empty());
+            return (*this)[0];}
+
+        const_reference front () const {
+            return const_cast<mapped_deque*>(this)->front();}
+
+        // ---
+        // pop
+        // ---
+
+        void pop_back () {
+            assert(!empty());
+            --h().size;
+            if (h().size == 0)
+                clear();
+            else if (((h().front + h().size) % B) == 0) {
+                --h().blocks;
+                release_block(slots()[h().first + h().blocks]);}
+            assert(valid());}
+
+        void pop_front () {
+            assert(!empty());
+            --h().size;
+            if (h().size == 0)
+                clear();
+            else if (++h().front == B) {
+                release_block(slots()[h().first]);
+                ++h().first;
+                --h().blocks;
+                h().front = 0;}
+            assert(valid());}
+
+        // ----
+        // push
+        // ----
+
+        void push_back (const_reference v) {
+            const value_type x(v); // v may be in the mapping, which may move
+            const size_type e = h().front + h().size;
+            if ((e / B) == h().blocks) {
+                reserve_map(false);
+                const offset o = allocate_block();
+                slots()[h().first + h().blocks] = o;
+                ++h().blocks;}
+            (*this)[h().size] = x;
+            ++h().size;
+            assert(valid());}
+
+        void push_front (const_reference v) {
+            const value_type x(v); // v may be in the mapping, which may move
+            if (h().front == 0) {
+                reserve_map(true);
+                const offset o = allocate_block();
+                --h().first;
+                slots()[h().first] = o;
+                ++h().blocks;
+                h().front = B;}
+            --h().front;
+            ++h().size;
+            (*this)[0] = x;
+            assert(valid());}
+
+        // ----
+        // size
+        // ----
+
+        size_type size () const {
+            return h().size;}};
+
+#endif // MappedDeque_h
@@ -0,0 +1,187 @@
+// ------------------------------
+// projects/deque/ParallelDeque.h
+// Copyright (C) 2014
+// Glenn P. Downing
+// ------------------------------
+
+#ifndef ParallelDeque_h
+#define ParallelDeque_h
+
+// --------
+// includes
+// --------
+
+#include <algorithm>  // inplace_merge, lower_bound, max, sort, transform, upper_bound
+#include <atomic>     // atomic
+#include <cstddef>    // size_t
+#include <functional> // less, plus
+#include <vector>     // vector
+
+#include "Deque.h"
+#include "WorkStealingDeque.h"
+
+// ---------------
+// parallel_policy
+// ---------------
+
+/**
+ * Execution policy for the algorithms below, in the spirit of
+ * std::execution::par: the pool to run on and the least number of
+ * elements worth a task of their own (0 picks about four tasks per
+ * worker). The algorithms hand each task whole blocks, so no two tasks
+ * ever write to the same block. Tasks must not throw.
+ */
+struct parallel_policy {
+    work_stealing_pool* pool;
+    std::size_t         grain;};
+
+/**
+ * A policy that runs on p.
+ */
+inline parallel_policy par (work_stealing_pool& p, std::size_t grain = 0) {
+    const parallel_policy x = {&p, grain};
+    return x;}
+
+// ---------------
+// parallel_chunks
+// ---------------
+
+/**
+ * Offsets that cut x into runs of whole blocks of at least the policy's
+ * grain: chunk i is [c[i], c[i + 1]). Only the first and last blocks of
+ * x may be partly used, so every cut is at a block boundary.
+ */
+template <typename D>
+std::vector<std::size_t> parallel_chunks (const parallel_policy& p, const D& x) {
+    const std::size_t tasks = 4 * p.pool->size();
+    const std::size_t grain = std::max<std::size_t>(p.grain ? p.grain : (x.size() / tasks), 1);
+    std::vector<std::size_t> c(1, 0);
+    std::size_t n = 0;
+    for (const auto& s : x.segments()) {
+        n += s.size;
+        if ((n - c.back()) >= grain)
+            c.push_back(n);}
+    if (c.back() != n)
+        c.push_back(n);
+    return c;}
+
+// ------------
+// parallel_run
+// ------------
+
+/**
+ * Calls f(c[i], c[i + 1]) for every chunk, one task each, and returns
+ * once all of them are done.
+ */
+template <typename F>
+void parallel_run (const parallel_policy& p, const std::vector<std::size_t>& c, F f) {
+    const std::size_t k = c.size() - 1;
+    std::atomic<std::size_t> left(k);
+    for (std::size_t i = 0; i != k; ++i)
+        p.pool->spawn([&f, &c, &left, i] () {
+            f(c[i], c[i + 1]);
+            left.fetch_sub(1, std::memory_order_release);});
+    p.pool->wait(left);}
+
+// --------
+// for_each
+// --------
+
+/**
+ * Calls f on every element of x, block by block across the pool.
+ */
+template <typename T, typename A, std::size_t B, typename S, typename F>
+void for_each (const parallel_policy& p, my_deque<T, A, B, S>& x, F f) {
+    typedef my_deque<T, A, B, S> deque_type;
+    parallel_run(p, parallel_chunks(p, x), [&x, &f] (std::size_t b, std::size_t e) {
+        for (const typename deque_type::segment& s : deque_type::segments(x.begin() + b, x.begin() + e))
+            for (T* q = s.begin(); q != s.end(); ++q)
+                f(*q);});}
+
+// ---------
+// transform
+// ---------
+
+/**
+ * Resizes y to x's size and sets y[i] to f(x[i]), split along y's
+ * blocks, which are the ones written.
+ */
+template <typename T, typename A, std::size_t B, typename S, typename U, typename A2, std::size_t B2, typename S2, typename F>
+void transform (const parallel_policy& p, const my_deque<T, A, B, S>& x, my_deque<U, A2, B2, S2>& y, F f) {
+    typedef my_deque<T, A, B, S>    source_type;
+    typedef my_deque<U, A2, B2, S2> target_type;
+    y.resize(x.size());
+    parallel_run(p, parallel_chunks(p, y), [&x, &y, &f] (std::size_t b, std::size_t e) {
+        typename source_type::const_iterator i = x.begin() + b;
+        for (const typename target_type::segment& t : target_type::segments(y.begin() + b, y.begin() + e)) {
+            U* q = t.begin();
+            for (const typename source_type::const_segment& s : source_type::segments(i, i + t.size))
+                q = std::transform(s.begin(), s.end(), q, f);
+            i += t.size;}});}
+
+// ------
+// reduce
+// ------
+
+/**
+ * Folds x into init with op, which must be associative: each chunk is
+ * folded on its own, starting from its first element, and the results
+ * are folded into init in order.
+ */
+template <typename T, typename A, std::size_t B, typename S, typename U, typename F>
+U reduce (const parallel_policy& p, const my_deque<T, A, B, S>& x, U init, F op) {
+    typedef my_deque<T, A, B, S> deque_type;
+    const std::vector<std::size_t> c = parallel_chunks(p, x);
+    std::vector<U> r(c.size() - 1, init);
+    parallel_run(p, c, [&x, &op, &r, &c] (std::size_t b, std::size_t e) {
+        typename deque_type::const_iterator i = x.begin() + b;
+        U v = *i;
+        ++i;
+        for (const typename deque_type::const_segment& s : deque_type::segments(i, x.begin() + e))
+            for (const T* q = s.begin(); q != s.end(); ++q)
+                v = op(v, *q);
+        r[std::lower_bound(c.begin(), c.end(), b) - c.begin()] = v;});
+    for (std::size_t i = 0; i != r.size(); ++i)
+        init = op(init, r[i]);
+    return init;}
+
+/**
+ * Sums x into init.
+ */
+template <typename T, typename A, std::size_t B, typename S, typename U>
+U reduce (const parallel_policy& p, const my_deque<T, A, B, S>& x, U init) {
+    return reduce(p, x, init, std::plus<U>());}
+
+// ----
+// sort
+// ----
+
+/**
+ * Sorts x by comp: every chunk is sorted by its own task, then adjacent
+ * sorted runs are merged pairwise, each round's merges in parallel.
+ */
+template <typename T, typename A, std::size_t B, typename S, typename C>
+void sort (const parallel_policy& p, my_deque<T, A, B, S>& x, C comp) {
+    std::vector<std::size_t> c = parallel_chunks(p, x);
+    parallel_run(p, c, [&x, &comp] (std::size_t b, std::size_t e) {
+        std::sort(x.begin() + b, x.begin() + e, comp);});
+    while (c.size() > 2) {
+        std::vector<std::size_t> next(1, 0);
+        for (std::size_t i = 2; i < c.size(); i += 2)
+            next.push_back(c[i]);
+        if (next.back() != c.back())
+            next.push_back(c.back());
+        parallel_run(p, next, [&x, &comp, &c] (std::size_t b, std::size_t e) {
+            const std::size_t m = *std::upper_bound(c.begin(), c.end(), b);
+            if (m < e)
+                std::inplace_merge(x.begin() + b, x.begin() + m, x.begin() + e, comp);});
+        c.swap(next);}}
+
+/**
+ * Sorts x by <.
+ */
+template <typename T, typename A, std::size_t B, typename S>
+void sort (const parallel_policy& p, my_deque<T, A, B, S>& x) {
+    sort(p, x, std::less<T>());}
+
+#endif // ParallelDeque_h
@@ -0,0 +1,297 @@
+// --------------------------
+// projects/deque/SPSCDeque.h
+// Copyright (C) 2014
+// Glenn P. Downing
+// --------------------------
+
+#ifndef SPSCDeque_h
+#define SPSCDeque_h
+
+// --------
+// includes
+// --------
+
+#include <atomic>      // atomic, memory_order_acquire, memory_order_relaxed, memory_order_release
+#include <cassert>     // assert
+#include <cstddef>     // size_t
+#include <memory>      // allocator, allocator_traits
+#include <type_traits> // aligned_storage, alignment_of
+#include <utility>     // forward, move
+
+#include "Deque.h"
+
+// ----------
+// spsc_deque
+// ----------
+
+/**
+ * Queue for handing elements from exactly one producer thread to exactly
+ * one consumer thread without locks. Elements live in blocks of B, as in
+ * my_deque, but the blocks form a singly linked list instead of a map:
+ * the producer links a new block at the tail when its block is full and
+ * never waits for the consumer, and the consumer hands every block it
+ * drains back to the producer for reuse. The only shared state is the
+ * pair of element counters, published with release/acquire, and the
+ * stack of drained blocks.
+ *
+ * push_back and emplace_back may only be called by the producer;
+ * front and pop_front only by the consumer; size and empty by either,
+ * and are exact only when the other side is idle.
+ */
+template < typename T, typename A = std::allocator<T>, std::size_t B = my_deque_block_size<T>::value >
+class spsc_deque {
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef A                                        allocator_type;
+        typedef typename allocator_type::value_type      value_type;
+
+        typedef typename allocator_type::size_type       size_type;
+        typedef typename allocator_type::difference_type difference_type;
+
+        typedef typename allocator_type::pointer         pointer;
+        typedef typename allocator_type::const_pointer   const_pointer;
+
+        typedef typename allocator_type::reference       reference;
+        typedef typename allocator_type::const_reference const_reference;
+
+        // ---------
+        // constants
+        // ---------
+
+        static const size_type block_size = B;
+
+        static_assert(B > 0, "spsc_deque block size must be positive");
+
+    private:
+        // -----
+        // block
+        // -----
+
+        /**
+         * B slots of raw storage and the link to the next block, which is
+         * written by the producer before it publishes any element of the
+         * next block, or by the consumer when it hands the block back.
+         */
+        struct block {
+            typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type slots[B];
+            block* next;
+
+            pointer slot (size_type i) {
+                return reinterpret_cast<pointer>(&slots[i]);}};
+
+        typedef typename std::allocator_traits<A>::template rebind_alloc<block> block_allocator_type;
+
+        // ----
+        // data
+        // ----
+
+        allocator_type       _a;
+        block_allocator_type _ba;
+
+        // consumer side
+
+        alignas(64) block* _hb;             // block holding the front
+        size_type          _hi;             // index of the front in _hb
+        std::atomic<size_type> _head;       // elements popped so far
+
+        // producer side
+
+        alignas(64) block* _tb;             // block holding the back
+        size_type          _ti;             // index of the next push in _tb
+        block*             _spare;          // drained blocks taken from _free
+        size_type          _allocations;
+        std::atomic<size_type> _tail;       // elements pushed so far
+
+        // drained blocks on their way from the consumer to the producer
+
+        alignas(64) std::atomic<block*> _free;
+
+        // ------------
+        // obtain_block
+        // ------------
+
+        /**
+         * Producer: a drained block if the consumer has handed any back,
+         * a new one otherwise.
+         */
+        block* obtain_block () {
+            if (!_spare)
+                _spare = _free.exchange(0, std::memory_order_acquire);
+            block* b = _spare;
+            if (b)
+                _spare = b->next;
+            else {
+                b = _ba.allocate(1);
+                ++_allocations;}
+            b->next = 0;
+            return b;}
+
+        // ------------
+        // return_block
+        // ------------
+
+        /**
+         * Consumer: pushes a drained block on the stack the producer takes
+         * its blocks from.
+         */
+        void return_block (block* b) {
+            block* h = _free.load(std::memory_order_relaxed);
+            do {
+                b->next = h;}
+            while (!_free.compare_exchange_weak(h, b, std::memory_order_release, std::memory_order_relaxed));}
+
+        // ----------
+        // free_chain
+        // ----------
+
+        void free_chain (block* b) {
+            while (b) {
+                block* const n = b->next;
+                _ba.deallocate(b, 1);
+                b = n;}}
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        explicit spsc_deque (const allocator_type& a = allocator_type()) :
+                _a           (a),
+                _ba          (_a),
+                _hb          (0),
+                _hi          (0),
+                _head        (0),
+                _tb          (0),
+                _ti          (0),
+                _spare       (0),
+                _allocations (0),
+                _tail        (0),
+                _free        (0) {
+            _hb = _tb = obtain_block();}
+
+        spsc_deque             (const spsc_deque&) = delete;
+        spsc_deque& operator = (const spsc_deque&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+        /**
+         * Both threads must be done with the queue.
+         */
+        ~spsc_deque () {
+            while (!empty())
+                pop_front();
+            free_chain(_hb);
+            free_chain(_spare);
+            free_chain(_free.load(std::memory_order_acquire));}
+
+        // -----------------
+        // block_allocations
+        // -----------------
+
+        /**
+         * Number of blocks obtained from the allocator so far; read it
+         * from the producer or once the producer is done.
+         */
+        size_type block_allocations () const {
+            return _allocations;}
+
+        // -------
+        // emplace
+        // -------
+
+        /**
+         * Producer: constructs a new back element from args and publishes
+         * it to the consumer.
+         */
+        template <typename... Args>
+        void emplace_back (Args&&... args) {
+            if (_ti == B) {
+                block* const b = obtain_block();
+                _tb->next = b;
+                _tb = b;
+                _ti = 0;}
+            _a.construct(_tb->slot(_ti), std::forward<Args>(args)...);
+            ++_ti;
+            _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);}
+
+        // -----
+        // empty
+        // -----
+
+        bool empty () const {
+            return size() == 0;}
+
+        // -----
+        // front
+        // -----
+
+        /**
+         * Consumer: the front element, or 0 if the queue is empty.
+         */
+        pointer front () {
+            const size_type h = _head.load(std::memory_order_relaxed);
+            if (h == _tail.load(std::memory_order_acquire))
+                return 0;
+            if (_hi == B) {
+                block* const b = _hb;
+                _hb = b->next;
+                _hi = 0;
+                return_block(b);}
+            return _hb->slot(_hi);}
+
+        // ---------
+        // pop_front
+        // ---------
+
+        /**
+         * Consumer: destroys the front element, which must exist.
+         */
+        void pop_front () {
+            const pointer p = front();
+            assert(p);
+            _a.destroy(p);
+            ++_hi;
+            _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);}
+
+        /**
+         * Consumer: moves the front element into v and pops it; returns
+         * false, leaving v alone, if the queue is empty.
+         */
+        bool pop_front (reference v) {
+            const pointer p = front();
+            if (!p)
+                return false;
+            v = std::move(*p);
+            pop_front();
+            return true;}
+
+        // ----
+        // push
+        // ----
+
+        /**
+         * Producer: copies v in at the back.
+         */
+        void push_back (const_reference v) {
+            emplace_back(v);}
+
+        /**
+         * Producer: moves v in at the back.
+         */
+        void push_back (value_type&& v) {
+            emplace_back(std::move(v));}
+
+        // ----
+        // size
+        // ----
+
+        size_type size () const {
+            const size_type h = _head.load(std::memory_order_acquire);
+            return _tail.load(std::memory_order_acquire) - h;}};
+
+#endif // SPSCDeque_h
@@ -0,0 +1,583 @@
+// ---------------------------
+// projects/deque/SmallDeque.h
+// Copyright (C) 2014
+// Glenn P. Downing
+// ---------------------------
+
+#ifndef SmallDeque_h
+#define SmallDeque_h
+
+// --------
+// includes
+// --------
+
+#include <algorithm>   // equal
+#include <cassert>     // assert
+#include <cstddef>     // ptrdiff_t, size_t
+#include <iterator>    // random_access_iterator_tag
+#include <memory>      // allocator
+#include <stdexcept>   // out_of_range
+#include <type_traits> // aligned_storage, alignment_of
+#include <utility>     // declval, forward, move, move_if_noexcept
+
+#include "Deque.h"
+
+// -----------
+// small_deque
+// -----------
+
+/**
+ * Deque that keeps up to N elements inside the object, in a ring of N
+ * slots, and only spills into the blocks of a my_deque<T, A, B> when it
+ * outgrows them. A deque that never holds more than N elements makes no
+ * allocation at all, which suits the many short-lived, nearly empty
+ * queues of a server (one per connection, say).
+ *
+ * The spill moves the N inline elements to the front of the my_deque,
+ * all or nothing, and the deque stays spilled from then on: draining it
+ * keeps its blocks for the next burst, as my_deque does. shrink_to_fit
+ * brings a spilled deque that fits back inline. Pushes and pops invalidate
+ * references while the deque is inline and across the spill; once
+ * spilled, my_deque's rules apply.
+ */
+template < typename T, std::size_t N = 16, typename A = std::allocator<T>, std::size_t B = my_deque_block_size<T>::value >
+class small_deque {
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef my_deque<T, A, B>                        deque_type;
+
+        typedef A                                        allocator_type;
+        typedef typename allocator_type::value_type      value_type;
+
+        typedef typename allocator_type::size_type       size_type;
+        typedef typename allocator_type::difference_type difference_type;
+
+        typedef typename allocator_type::pointer         pointer;
+        typedef typename allocator_type::const_pointer   const_pointer;
+
+        typedef typename allocator_type::reference       reference;
+        typedef typename allocator_type::const_reference const_reference;
+
+        // ---------
+        // constants
+        // ---------
+
+        /**
+         * Elements held without allocating.
+         */
+        static const size_type inline_capacity = N;
+
+        static_assert(N > 0, "small_deque inline capacity must be positive");
+
+    public:
+        // -----------
+        // operator ==
+        // -----------
+
+        friend bool operator == (const small_deque& lhs, const small_deque& rhs) {
+            return (lhs.size() == rhs.size()) && std::equal(lhs.begin(), lhs.end(), rhs.begin());}
+
+        friend bool operator != (const small_deque& lhs, const small_deque& rhs) {
+            return !(lhs == rhs);}
+
+    private:
+        // ----
+        // data
+        // ----
+
+        typedef typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type storage;
+
+        allocator_type _a;
+        deque_type     _x;                  // the elements once spilled
+        storage        _slots[N];
+        size_type      _head;               // ring slot of the inline front
+        size_type      _size;               // inline elements
+        bool           _spilled;
+
+        // -----
+        // valid
+        // -----
+
+        bool valid () const {
+            return (_head < N) && (_size <= N) && (!_spilled || !_size);}
+
+        // ----
+        // slot
+        // ----
+
+        /**
+         * Ring slot of inline element i.
+         */
+        pointer slot (size_type i) const {
+            return reinterpret_cast<pointer>(const_cast<storage*>(_slots + ((_head + i) % N)));}
+
+        // --------------
+        // destroy_inline
+        // --------------
+
+        void destroy_inline () {
+            for (size_type i = 0; i != _size; ++i)
+                _a.destroy(slot(i));
+            _head = _size = 0;}
+
+        // -----
+        // spill
+        // -----
+
+        /**
+         * Moves the inline elements into _x, or copies them if their move
+         * may throw; if one throws, _x is left empty and the inline
+         * elements as they were.
+         */
+        void spill () {
+            size_type i = 0;
+            _x.append_n(_size, [this, &i] () -> decltype(std::move_if_noexcept(std::declval<reference>())) {
+                return std::move_if_noexcept(*slot(i++));});
+            destroy_inline();
+            _spilled = true;}
+
+        // ----
+        // take
+        // ----
+
+        /**
+         * Moves that's elements into *this, which must be empty and
+         * inline, and leaves that empty.
+         */
+        void take (small_deque& that) {
+            if (that._spilled) {
+                _x = std::move(that._x);
+                _spilled = true;}
+            else {
+                for (; _size != that._size; ++_size)
+                    _a.construct(slot(_size), std::move(*that.slot(_size)));
+                that.destroy_inline();}}
+
+    public:
+        // --------------
+        // basic_iterator
+        // --------------
+
+        /**
+         * Random-access iterator by position, so that it reads the same
+         * whether the elements are inline or spilled; C is the deque type,
+         * const for a const_iterator.
+         */
+        template <typename C, typename V>
+        class basic_iterator {
+            public:
+                // --------
+                // typedefs
+                // --------
+
+                typedef std::random_access_iterator_tag iterator_category;
+                typedef typename small_deque::value_type      value_type;
+                typedef typename small_deque::difference_type difference_type;
+                typedef V*                                    pointer;
+                typedef V&                                    reference;
+
+            private:
+                // ----
+                // data
+                // ----
+
+                C*        _c;
+                size_type _i;
+
+            public:
+                // -----------
+                // constructor
+                // -----------
+
+                basic_iterator () : _c(0), _i(0) {}
+
+                basic_iterator (C* c, size_type i) : _c(c), _i(i) {}
+
+                /**
+                 * iterator to const_iterator.
+                 */
+                template <typename C2, typename V2>
+                basic_iterator (const basic_iterator<C2, V2>& that) : _c(that.container()), _i(that.index()) {}
+
+                // ---------
+                // accessors
+                // ---------
+
+                C* container () const {
+                    return _c;}
+
+                size_type index () const {
+                    return _i;}
+
+                // ---------
+                // operators
+                // ---------
+
+                reference operator * () const {
+                    return (*_c)[_i];}
+
+                pointer operator -> () const {
+                    return &**this;}
+
+                reference operator [] (difference_type d) const {
+                    return (*_c)[_i + d];}
+
+                basic_iterator& operator ++ () {
+                    ++_i;
+                    return *this;}
+
+                basic_iterator operator ++ (int) {
+                    basic_iterator x = *this;
+                    ++_i;
+                    return x;}
+
+                basic_iterator& operator -- () {
+                    --_i;
+                    return *this;}
+
+                basic_iterator operator -- (int) {
+                    basic_iterator x = *this;
+                    --_i;
+                    return x;}
+
+                basic_iterator& operator += (difference_type d) {
+                    _i += d;
+                    return *this;}
+
+                basic_iterator& operator -= (difference_type d) {
+                    _i -= d;
+                    return *this;}
+
+                friend basic_iterator operator + (basic_iterator lhs, difference_type rhs) {
+                    return lhs += rhs;}
+
+                friend basic_iterator operator + (difference_type lhs, basic_iterator rhs) {
+                    return rhs += lhs;}
+
+                friend basic_iterator operator - (basic_iterator lhs, difference_type rhs) {
+                    return lhs -= rhs;}
+
+                friend difference_type operator - (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return difference_type(lhs._i) - difference_type(rhs._i);}
+
+                friend bool operator == (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return lhs._i == rhs._i;}
+
+                friend bool operator != (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return lhs._i != rhs._i;}
+
+                friend bool operator < (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return lhs._i < rhs._i;}
+
+                friend bool operator > (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return rhs < lhs;}
+
+                friend bool operator <= (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return !(rhs < lhs);}
+
+                friend bool operator >= (const basic_iterator& lhs, const basic_iterator& rhs) {
+                    return !(lhs < rhs);}};
+
+        typedef basic_iterator<small_deque, value_type>             iterator;
+        typedef basic_iterator<const small_deque, const value_type> const_iterator;
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        explicit small_deque (const allocator_type& a = allocator_type()) :
+                _a       (a),
+                _x       (a),
+                _head    (0),
+                _size    (0),
+                _spilled (false) {
+            assert(valid());}
+
+        small_deque (const small_deque& that) :
+                _a       (that._a),
+                _x       (that._a),
+                _head    (0),
+                _size    (0),
+                _spilled (that._spilled) {
+            if (_spilled)
+                _x = that._x;
+            else
+                try {
+                    for (; _size != that._size; ++_size)
+                        _a.construct(slot(_size), *that.slot(_size));}
+                catch (...) {
+                    destroy_inline();
+                    throw;}
+            assert(valid());}
+
+        /**
+         * Takes over that's blocks if it has spilled, otherwise moves its
+         * inline elements one by one; that is left empty.
+         */
+        small_deque (small_deque&& that) :
+                _a       (that._a),
+                _x       (that._a),
+                _head    (0),
+                _size    (0),
+                _spilled (false) {
+            take(that);
+            assert(valid());}
+
+        // ----------
+        // destructor
+        // ----------
+
+        ~small_deque () {
+            destroy_inline();}
+
+        // ----------
+        // operator =
+        // ----------
+
+        small_deque& operator = (const small_deque& rhs) {
+            if (this != &rhs) {
+                small_deque x(rhs);
+                *this = std::move(x);}
+            return *this;}
+
+        small_deque& operator = (small_deque&& rhs) {
+            if (this != &rhs) {
+                reset();
+                take(rhs);}
+            assert(valid());
+            return *this;}
+
+        // -----------
+        // operator []
+        // -----------
+
+        reference operator [] (size_type i) {
+            return _spilled ? _x[i] : *slot(i);}
+
+        const_reference operator [] (size_type i) const {
+            return const_cast<small_deque*>(this)->operator[](i);}
+
+        // --
+        // at
+        // --
+
+        reference at (size_type i) {
+            if (i >= size())
+                throw std::out_of_range("small_deque");
+            return (*this)[i];}
+
+        const_reference at (size_type i) const {
+            return const_cast<small_deque*>(this)->at(i);}
+
+        // ----
+        // back
+        // ----
+
+        reference back () {
+            assert(!empty());
+            return (*this)[size() - 1];}
+
+        const_reference back () const {
+            return const_cast<small_deque*>(this)->back();}
+
+        // -----
+        // begin
+        // -----
+
+        iterator begin () {
+            return iterator(this, 0);}
+
+        const_iterator begin () const {
+            return const_iterator(this, 0);}
+
+        // -----
+        // clear
+        // -----
+
+        /**
+         * Removes every element; a spilled deque keeps its blocks.
+         */
+        void clear () {
+            if (_spilled)
+                _x.clear();
+            else
+                destroy_inline();
+            assert(valid());}
+
+        // -------
+        // emplace
+        // -------
+
+        /**
+         * Constructs a new back element in place from args, spilling if
+         * the inline slots are full.
+         */
+        template <typename... Args>
+        void emplace_back (Args&&... args) {
+            if (!_spilled && (_size == N)) {
+                value_type v(std::forward<Args>(args)...); // args may refer to an inline element
+                spill();
+                _x.emplace_back(std::move(v));}
+            else if (_spilled)
+                _x.emplace_back(std::forward<Args>(args)...);
+            else {
+                _a.construct(slot(_size), std::forward<Args>(args)...);
+                ++_size;}
+            assert(valid());}
+
+        /**
+         * Constructs a new front element in place from args, spilling if
+         * the inline slots are full.
+         */
+        template <typename... Args>
+        void emplace_front (Args&&... args) {
+            if (!_spilled && (_size == N)) {
+                value_type v(std::forward<Args>(args)...); // args may refer to an inline element
+                spill();
+                _x.emplace_front(std::move(v));}
+            else if (_spilled)
+                _x.emplace_front(std::forward<Args>(args)...);
+            else {
+                const size_type h = (_head + N - 1) % N;
+                _a.construct(reinterpret_cast<pointer>(_slots + h), std::forward<Args>(args)...);
+                _head = h;
+                ++_size;}
+            assert(valid());}
+
+        // -----
+        // empty
+        // -----
+
+        bool empty () const {
+            return size() == 0;}
+
+        // ---
+        // end
+        // ---
+
+        iterator end () {
+            return iterator(this, size());}
+
+        const_iterator end () const {
+            return const_iterator(this, size());}
+
+        // -----
+        // front
+        // -----
+
+        reference front () {
+            assert(!empty());
+            return (*this)[0];}
+
+        const_reference front () const {
+            return const_cast<small_deque*>(this)->front();}
+
+        // ---------
+        // is_inline
+        // ---------
+
+        /**
+         * True while the elements live inside the object.
+         */
+        bool is_inline () const {
+            return !_spilled;}
+
+        // ---
+        // pop
+        // ---
+
+        void pop_back () {
+            assert(!empty());
+            if (_spilled)
+                _x.pop_back();
+            else {
+                _a.destroy(slot(_size - 1));
+                --_size;}
+            assert(valid());}
+
+        void pop_front () {
+            assert(!empty());
+            if (_spilled)
+                _x.pop_front();
+            else {
+                _a.destroy(slot(0));
+                _head = (_head + 1) % N;
+                --_size;}
+            assert(valid());}
+
+        // ----
+        // push
+        // ----
+
+        void push_back (const_reference v) {
+            emplace_back(v);}
+
+        void push_back (value_type&& v) {
+            emplace_back(std::move(v));}
+
+        void push_front (const_reference v) {
+            emplace_front(v);}
+
+        void push_front (value_type&& v) {
+            emplace_front(std::move(v));}
+
+        // -----
+        // reset
+        // -----
+
+        /**
+         * Removes every element and frees every block, going back inline.
+         */
+        void reset () {
+            destroy_inline();
+            _x.clear();
+            _x.shrink_to_fit();
+            _spilled = false;
+            assert(valid());}
+
+        // -------------
+        // shrink_to_fit
+        // -------------
+
+        /**
+         * Moves a spilled deque of at most N elements back inline and
+         * frees its blocks; shrinks the blocks of a bigger one.
+         */
+        void shrink_to_fit () {
+            if (_spilled && (_x.size() <= N)) {
+                try {
+                    for (; _size != _x.size(); ++_size)
+                        _a.construct(slot(_size), std::move_if_noexcept(_x[_size]));}
+                catch (...) {
+                    destroy_inline();
+                    throw;}
+                _spilled = false;
+                _x.clear();}
+            _x.shrink_to_fit();
+            assert(valid());}
+
+        // ----
+        // size
+        // ----
+
+        size_type size () const {
+            return _spilled ? _x.size() : _size;}
+
+        // ----
+        // swap
+        // ----
+
+        /**
+         * Inline elements can't trade places by pointer, so this moves
+         * them through a temporary.
+         */
+        void swap (small_deque& that) {
+            small_deque x(std::move(*this));
+            *this = std::move(that);
+            that = std::move(x);}};
+
+#endif // SmallDeque_h
@@ -37,16 +37,41 @@ To obtain coverage of the test:
 // includes
 // --------
 
-#include <algorithm> // equal
+#include <algorithm> // equal, is_sorted, lower_bound, max, reverse, sort
+#include <atomic>    // atomic
+#include <cstddef>   // size_t
+#include <cstdio>    // remove
 #include <cstring>   // strcmp
 #include <deque>     // deque
-#include <sstream>   // ostringstream
+#include <fstream>   // ifstream
+#include <iterator>  // distance, istream_iterator
+#include <sstream>   // istringstream, ostringstream
+#include <memory>    // unique_ptr
+#include <numeric>   // accumulate
 #include <stdexcept> // invalid_argument
-#include <string>    // ==
+#include <string>    // ==, string
+#include <thread>    // thread
+#include <type_traits> // is_pointer
+#include <utility>   // move
+#include <vector>    // vector
 
 #include "gtest/gtest.h"
 
+#ifdef __GLIBC__
+#include <malloc.h>  // malloc_trim
+#endif
+#include <unistd.h>  // sysconf
+
+#include "BlockPool.h"
+#include "BoundedDeque.h"
+#include "CowDeque.h"
 #include "Deque.h"
+#include "DequeIO.h"
+#include "MappedDeque.h"
+#include "ParallelDeque.h"
+#include "SPSCDeque.h"
+#include "SmallDeque.h"
+#include "WorkStealingDeque.h"
 
 #define ALL_OF_IT   typedef typename TestFixture::deque_type      deque_type; \
                     typedef typename TestFixture::allocator_type  allocator_type; \
@@ -82,7 +107,10 @@ typedef testing::Types<
             std::deque<int>,
             std::deque<double>,
             my_deque<int>,
-            my_deque<double> >
+            my_deque<double>,
+            my_deque<int,    std::allocator<int>,    3>,
+            my_deque<double, std::allocator<double>, 4>,
+            my_deque<int,    block_pool_allocator<int> > >
         my_types;
 
 TYPED_TEST_CASE(TestDeque, my_types);
@@ -205,6 +233,24 @@ TYPED_TEST(TestDeque, Indexing_5) {
     value_type temp = x[24];
     ASSERT_EQ(5, temp);}
 
+TYPED_TEST(TestDeque, Indexing_6) {
+    ALL_OF_IT;
+
+    deque_type x;
+    for (int i = 0; i != 2000; ++i) {
+        x.push_front(-i);
+        x.push_back(i);}
+    for (int i = 0; i != 1500; ++i)
+        x.pop_front();
+    x.insert(x.begin() + 3, 7, 9);
+    x.erase(x.begin() + 1, x.begin() + 2);
+    ASSERT_EQ(2506, x.size());
+    ASSERT_EQ(-499, x[0]);
+    ASSERT_EQ(9,    x[2]);
+    ASSERT_EQ(-496, x[9]);
+    ASSERT_EQ(0,    x[506]);
+    ASSERT_EQ(1999, x.at(2505));}
+
 // --------
 // At Tests
 // --------
@@ -440,6 +486,30 @@ TYPED_TEST(TestDeque, Erase_4) {
     const size_type s = x.size();
     ASSERT_EQ(0, s);}
 
+TYPED_TEST(TestDeque, Erase_5) {
+    ALL_OF_IT;
+
+    deque_type x;
+    for (int i = 0; i != 30; ++i)
+        x.push_back(i);
+    typename deque_type::iterator it = x.erase(x.begin() + 2, x.begin() + 9);
+    ASSERT_EQ(23, x.size());
+    ASSERT_EQ(9, *it);
+    ASSERT_EQ(1, x[1]);
+    ASSERT_EQ(29, x.back());}
+
+TYPED_TEST(TestDeque, Erase_6) {
+    ALL_OF_IT;
+
+    deque_type x;
+    for (int i = 0; i != 30; ++i)
+        x.push_back(i);
+    typename deque_type::iterator it = x.erase(x.end() - 9, x.end() - 2);
+    ASSERT_EQ(23, x.size());
+    ASSERT_EQ(28, *it);
+    ASSERT_EQ(20, x[20]);
+    ASSERT_EQ(0, x.front());}
+
 // -----------
 // Front Tests
 // -----------
@@ -511,6 +581,44 @@ TYPED_TEST(TestDeque, Insert_4) {
     const value_type temp = x[1];
     ASSERT_EQ(1, temp);}   
 
+TYPED_TEST(TestDeque, Insert_5) {
+    ALL_OF_IT;
+
+    deque_type x(20, 1);
+    typename deque_type::iterator it = x.insert(x.begin() + 2, 13, 7);
+    ASSERT_EQ(33, x.size());
+    ASSERT_EQ(7, *it);
+    ASSERT_EQ(1, x[1]);
+    ASSERT_EQ(7, x[14]);
+    ASSERT_EQ(1, x[15]);}
+
+TYPED_TEST(TestDeque, Insert_6) {
+    ALL_OF_IT;
+
+    deque_type x;
+    for (int i = 0; i != 20; ++i)
+        x.push_back(i);
+    const int a[] = {100, 101, 102, 103, 104};
+    x.insert(x.begin() + 17, a, a + 5);
+    x.insert(x.begin() + 3, a, a + 2);
+    ASSERT_EQ(27, x.size());
+    ASSERT_EQ(100, x[3]);
+    ASSERT_EQ(101, x[4]);
+    ASSERT_EQ(3, x[5]);
+    ASSERT_EQ(104, x[23]);
+    ASSERT_EQ(19, x.back());}
+
+TYPED_TEST(TestDeque, Insert_7) {
+    ALL_OF_IT;
+
+    deque_type x(2, 0);
+    std::istringstream in("1 2 3 4 5 6 7 8 9");
+    x.insert(x.begin() + 1, std::istream_iterator<int>(in), std::istream_iterator<int>());
+    ASSERT_EQ(11, x.size());
+    ASSERT_EQ(1, x[1]);
+    ASSERT_EQ(9, x[9]);
+    ASSERT_EQ(0, x.back());}
+
 // --------------
 // Pop_Back Tests
 // --------------
@@ -697,6 +805,38 @@ TYPED_TEST(TestDeque, Push_Font_4) {
     const value_type temp2 = x[4];
     ASSERT_EQ(0, temp2);}
 
+// -------------
+// Emplace Tests
+// -------------
+
+TYPED_TEST(TestDeque, Emplace_Back_1) {
+    ALL_OF_IT;
+
+    deque_type x;
+    for (int i = 0; i != 20; ++i)
+        x.emplace_back(i);
+    ASSERT_EQ(20, x.size());
+    ASSERT_EQ(19, x.back());}
+
+TYPED_TEST(TestDeque, Emplace_Front_1) {
+    ALL_OF_IT;
+
+    deque_type x(3, 1);
+    for (int i = 0; i != 20; ++i)
+        x.emplace_front(i);
+    ASSERT_EQ(23, x.size());
+    ASSERT_EQ(19, x.front());
+    ASSERT_EQ(1, x.back());}
+
+TYPED_TEST(TestDeque, Emplace_Front_2) {
+    ALL_OF_IT;
+
+    deque_type x(9, 2);
+    x.push_back(3);
+    x.emplace_front(x.back());
+    ASSERT_EQ(3, x.front());
+    ASSERT_EQ(11, x.size());}
+
 // ------------
 // Resize Tests
 // ------------
@@ -1128,6 +1268,181 @@ TYPED_TEST(TestDeque, I_Minus_Equals_3) {
     it -= 3;
     ASSERT_EQ(*it, 0);}
 
+// -------------------
+// Difference Operator
+// -------------------
+
+TYPED_TEST(TestDeque, I_Difference_1) {
+    ALL_OF_IT;
+
+    deque_type x(37);
+    const difference_type d = x.end() - x.begin();
+    ASSERT_EQ(37, d);}
+
+TYPED_TEST(TestDeque, I_Difference_2) {
+    ALL_OF_IT;
+
+    deque_type x(25);
+    x.push_front(1);
+    const difference_type d = (x.begin() + 3) - (x.end() - 4);
+    ASSERT_EQ(-19, d);}
+
+TYPED_TEST(TestDeque, I_Difference_3) {
+    ALL_OF_IT;
+
+    deque_type x(40);
+    const difference_type d = std::distance(x.begin(), x.end());
+    ASSERT_EQ(40, d);}
+
+// ----------
+// < Operator
+// ----------
+
+TYPED_TEST(TestDeque, I_Less_Than_1) {
+    ALL_OF_IT;
+
+    deque_type x(30);
+    ASSERT_TRUE(x.begin() < x.end());
+    ASSERT_FALSE(x.end() < x.begin());}
+
+TYPED_TEST(TestDeque, I_Less_Than_2) {
+    ALL_OF_IT;
+
+    deque_type x(30);
+    ASSERT_TRUE((x.begin() + 9) < (x.begin() + 10));
+    ASSERT_TRUE((x.begin() + 10) >= (x.begin() + 10));}
+
+// -----------
+// [] Operator
+// -----------
+
+TYPED_TEST(TestDeque, I_Subscript_1) {
+    ALL_OF_IT;
+
+    deque_type x;
+    for (int i = 0; i != 30; ++i)
+        x.push_back(i);
+    typename deque_type::iterator it = x.begin() + 5;
+    ASSERT_EQ(22, it[17]);
+    ASSERT_EQ(2, it[-3]);}
+
+// ---------------
+// Algorithm Tests
+// ---------------
+
+TYPED_TEST(TestDeque, I_Sort_1) {
+    ALL_OF_IT;
+
+    deque_type x;
+    for (int i = 0; i != 100; ++i)
+        x.push_front((i * 37) % 101);
+    std::sort(x.begin(), x.end());
+    ASSERT_TRUE(std::is_sorted(x.begin(), x.end()));
+    ASSERT_EQ(100, x.size());}
+
+TYPED_TEST(TestDeque, I_Lower_Bound_1) {
+    ALL_OF_IT;
+
+    deque_type x;
+    for (int i = 0; i != 50; ++i)
+        x.push_back(2 * i);
+    typename deque_type::iterator it = std::lower_bound(x.begin(), x.end(), 31);
+    ASSERT_EQ(16, it - x.begin());
+    ASSERT_EQ(32, *it);}
+
+// unqualified calls: std's algorithms for std::deque, the segmented
+// overloads for my_deque, both by argument-dependent lookup
+
+TYPED_TEST(TestDeque, I_For_Each_1) {
+    ALL_OF_IT;
+
+    deque_type x;
+    for (int i = 0; i != 600; ++i)
+        x.push_front(i);
+    for_each(x.begin(), x.end(), [] (value_type& v) {v *= 2;});
+    int n = 0;
+    const deque_type& y = x;
+    for_each(y.begin() + 1, y.end() - 1, [&] (const value_type&) {++n;});
+    ASSERT_EQ(598, n);
+    ASSERT_EQ(1198, x.front());
+    ASSERT_EQ(0, x.back());}
+
+TYPED_TEST(TestDeque, I_Copy_1) {
+    ALL_OF_IT;
+
+    deque_type x;
+    for (int i = 0; i != 700; ++i)
+        x.push_back(i);
+    std::vector<value_type> v(698);
+    copy(x.begin() + 1, x.end() - 1, v.begin());
+    ASSERT_EQ(1, v.front());
+    ASSERT_EQ(698, v.back());
+    deque_type y(700, 0);
+    copy(x.begin(), x.begin() + 400, y.begin() + 300);
+    ASSERT_EQ(0, y[299]);
+    ASSERT_EQ(399, y[699]);}
+
+TYPED_TEST(TestDeque, I_Fill_1) {
+    ALL_OF_IT;
+
+    deque_type x(900, 1);
+    fill(x.begin() + 3, x.end() - 3, 5);
+    ASSERT_EQ(1, x[2]);
+    ASSERT_EQ(5, x[3]);
+    ASSERT_EQ(5, x[896]);
+    ASSERT_EQ(1, x[897]);}
+
+TYPED_TEST(TestDeque, I_Find_Count_1) {
+    ALL_OF_IT;
+
+    deque_type x;
+    for (int i = 0; i != 1000; ++i)
+        x.push_back(i % 300);
+    typename deque_type::iterator p = find(x.begin(), x.end(), 299);
+    ASSERT_EQ(299, p - x.begin());
+    p = find(x.begin() + 300, x.end(), 299);
+    ASSERT_EQ(599, p - x.begin());
+    ASSERT_TRUE(find(x.begin(), x.end(), 300) == x.end());
+    ASSERT_EQ(4, count(x.begin(), x.end(), 7));
+    ASSERT_EQ(3, count(x.begin(), x.end(), 299));}
+
+TYPED_TEST(TestDeque, I_Accumulate_1) {
+    ALL_OF_IT;
+
+    deque_type x;
+    for (int i = 1; i <= 1000; ++i)
+        x.push_front(i);
+    ASSERT_EQ(500500, accumulate(x.begin(), x.end(), 0));
+    const deque_type& y = x;
+    ASSERT_EQ(1000, accumulate(y.begin(), y.end(), 0, [] (int a, const value_type& v) {return std::max<int>(a, v);}));}
+
+TYPED_TEST(TestDeque, I_Equal_1) {
+    ALL_OF_IT;
+
+    deque_type x;
+    deque_type y;
+    std::vector<value_type> v;
+    for (int i = 0; i != 800; ++i) {
+        x.push_back(i);
+        y.push_front(799 - i);
+        v.push_back(i);}
+    ASSERT_TRUE(equal(x.begin(), x.end(), y.begin()));
+    ASSERT_TRUE(equal(x.begin(), x.end(), v.begin()));
+    y[431] = 0;
+    ASSERT_FALSE(equal(x.begin(), x.end(), y.begin()));
+    ASSERT_TRUE(equal(x.begin(), x.begin() + 431, y.begin()));}
+
+TYPED_TEST(TestDeque, I_Reverse_1) {
+    ALL_OF_IT;
+
+    deque_type x;
+    for (int i = 0; i != 23; ++i)
+        x.push_back(i);
+    std::reverse(x.begin(), x.end());
+    ASSERT_EQ(22, x.front());
+    ASSERT_EQ(0, x.back());
+    ASSERT_EQ(11, x[11]);}
+
 // *********** Const Iterator ************ //
 
 // ---------------------
@@ -1374,3 +1689,2254 @@ TYPED_TEST(TestDeque, CI_Minus_Equals_3) {
     typename deque_type::const_iterator it = x.end();
     it -= 3;
     ASSERT_EQ(*it, 0);}
+
+// -------------------
+// Difference Operator
+// -------------------
+
+TYPED_TEST(TestDeque, CI_Difference_1) {
+    ALL_OF_IT;
+
+    const deque_type x(37);
+    const difference_type d = x.end() - x.begin();
+    ASSERT_EQ(37, d);}
+
+TYPED_TEST(TestDeque, CI_Difference_2) {
+    ALL_OF_IT;
+
+    const deque_type x(31, 4);
+    typename deque_type::const_iterator it = x.begin();
+    ASSERT_EQ(4, it[30]);
+    ASSERT_TRUE(it < x.end());}
+
+// ----------
+// Conversion
+// ----------
+
+TYPED_TEST(TestDeque, CI_Conversion_1) {
+    ALL_OF_IT;
+
+    deque_type x(12, 6);
+    typename deque_type::const_iterator it = x.begin() + 11;
+    ASSERT_EQ(6, *it);
+    ASSERT_TRUE(it == x.end() - 1);}
+
+// *********** Block Size ************ //
+
+// ------------------
+// Block Size Default
+// ------------------
+
+TEST(TestDequeBlockSize, Default_1) {
+    const std::size_t b = my_deque<int>::block_size;
+    ASSERT_EQ(4096 / sizeof(int), b);}
+
+TEST(TestDequeBlockSize, Default_2) {
+    const std::size_t b = my_deque<char>::block_size;
+    ASSERT_EQ(4096, b);}
+
+TEST(TestDequeBlockSize, Default_3) {
+    struct big {char c[1000];};
+    const std::size_t b = my_deque<big>::block_size;
+    ASSERT_EQ(16, b);}
+
+TEST(TestDequeBlockSize, Default_4) {
+    struct odd {char c[24];};
+    const std::size_t b = my_deque<odd>::block_size;
+    ASSERT_EQ(128, b);
+    ASSERT_EQ(0, b & (b - 1));}
+
+// -------------------
+// Block Size Explicit
+// -------------------
+
+TEST(TestDequeBlockSize, Explicit_1) {
+    my_deque<int, std::allocator<int>, 7> x;
+    for (int i = 0; i != 50; ++i)
+        x.push_back(i);
+    for (int i = 0; i != 50; ++i)
+        ASSERT_EQ(i, x[i]);}
+
+TEST(TestDequeBlockSize, Explicit_2) {
+    my_deque<int, std::allocator<int>, 1> x(3, 2);
+    x.push_front(1);
+    x.push_back(3);
+    ASSERT_EQ(5, x.size());
+    ASSERT_EQ(1, x.front());
+    ASSERT_EQ(3, x.back());
+    ASSERT_EQ(2, x[2]);}
+
+// *********** Move Semantics ************ //
+
+// ---------
+// move_only
+// ---------
+
+typedef std::unique_ptr<int> move_only;
+
+// -------
+// counted
+// -------
+
+struct counted {
+    static int copies;
+    static int moves;
+
+    int v;
+
+    counted (int i) : v(i) {}
+    counted (const counted& rhs) : v(rhs.v) {++copies;}
+    counted (counted&& rhs) noexcept : v(rhs.v) {++moves;}
+    counted& operator = (const counted& rhs) {v = rhs.v; ++copies; return *this;}
+    counted& operator = (counted&& rhs) noexcept {v = rhs.v; ++moves; return *this;}};
+
+int counted::copies = 0;
+int counted::moves  = 0;
+
+// -----------------
+// Move Construction
+// -----------------
+
+TEST(TestDequeMove, Construct_1) {
+    my_deque<std::string> x;
+    x.push_back("abc");
+    x.push_back(std::string(100, 'd'));
+    my_deque<std::string> y(std::move(x));
+    ASSERT_TRUE(x.empty());
+    ASSERT_EQ(2, y.size());
+    ASSERT_EQ(std::string(100, 'd'), y.back());}
+
+TEST(TestDequeMove, Construct_2) {
+    my_deque<std::string, std::allocator<std::string>, 2> x(5, "xyz");
+    const std::string* p = &x[3];
+    my_deque<std::string, std::allocator<std::string>, 2> y(std::move(x));
+    ASSERT_EQ(p, &y[3]);}
+
+// ---------------
+// Move Assignment
+// ---------------
+
+TEST(TestDequeMove, Assign_1) {
+    my_deque<std::string> x(3, "abc");
+    my_deque<std::string> y(7, "def");
+    y = std::move(x);
+    ASSERT_EQ(3, y.size());
+    ASSERT_EQ("abc", y.front());
+    ASSERT_TRUE(x.empty());}
+
+TEST(TestDequeMove, Assign_2) {
+    my_deque<std::string, std::allocator<std::string>, 3> x(10, "abc");
+    my_deque<std::string, std::allocator<std::string>, 3> y(2, "def");
+    y = x;
+    ASSERT_EQ(10, y.size());
+    ASSERT_TRUE(x == y);
+    y = my_deque<std::string, std::allocator<std::string>, 3>(1, "ghi");
+    ASSERT_EQ(1, y.size());
+    ASSERT_EQ("ghi", y[0]);}
+
+// ---------
+// Move-Only
+// ---------
+
+TEST(TestDequeMove, Move_Only_1) {
+    my_deque<move_only, std::allocator<move_only>, 4> x;
+    for (int i = 0; i != 30; ++i) {
+        x.push_back(move_only(new int(i)));
+        x.emplace_front(new int(-i));}
+    ASSERT_EQ(60, x.size());
+    ASSERT_EQ(-29, *x.front());
+    ASSERT_EQ(29, *x.back());}
+
+TEST(TestDequeMove, Move_Only_2) {
+    my_deque<move_only, std::allocator<move_only>, 4> x;
+    for (int i = 0; i != 10; ++i)
+        x.push_back(move_only(new int(i)));
+    x.insert(x.begin() + 3, move_only(new int(42)));
+    x.erase(x.begin());
+    ASSERT_EQ(10, x.size());
+    ASSERT_EQ(42, *x[2]);
+    ASSERT_EQ(3, *x[3]);}
+
+// ------
+// Growth
+// ------
+
+TEST(TestDequeMove, Growth_1) {
+    counted::copies = 0;
+    my_deque<counted, std::allocator<counted>, 4> x;
+    for (int i = 0; i != 200; ++i) {
+        x.emplace_back(i);
+        x.emplace_front(-i);}
+    ASSERT_EQ(0, counted::copies);
+    ASSERT_EQ(400, x.size());
+    ASSERT_EQ(199, x.back().v);}
+
+TEST(TestDequeMove, Growth_2) {
+    my_deque<std::string, std::allocator<std::string>, 2> x;
+    for (int i = 0; i != 100; ++i)
+        x.push_back(std::string(50, 'a' + (i % 26)));
+    x.resize(500, "z");
+    ASSERT_EQ(500, x.size());
+    ASSERT_EQ(std::string(50, 'a' + 25), x[25]);
+    ASSERT_EQ("z", x.back());}
+
+// *********** Allocator Propagation ************ //
+
+// ----------------
+// tagged_allocator
+// ----------------
+
+// Allocators that are equal only with the same tag; tagged_live[tag]
+// counts the bytes each tag has out, so freeing through the wrong one
+// shows up as a count that doesn't return to 0.
+
+long tagged_live[4];
+
+template <typename T, bool CA, bool MA, bool SW>
+struct tagged_allocator : std::allocator<T> {
+    typedef std::integral_constant<bool, CA> propagate_on_container_copy_assignment;
+    typedef std::integral_constant<bool, MA> propagate_on_container_move_assignment;
+    typedef std::integral_constant<bool, SW> propagate_on_container_swap;
+    typedef std::false_type                  is_always_equal;
+
+    template <typename U>
+    struct rebind {
+        typedef tagged_allocator<U, CA, MA, SW> other;};
+
+    int tag;
+
+    explicit tagged_allocator (int t = 0) : tag(t) {}
+
+    template <typename U>
+    tagged_allocator (const tagged_allocator<U, CA, MA, SW>& that) : tag(that.tag) {}
+
+    T* allocate (std::size_t n) {
+        tagged_live[tag] += n * sizeof(T);
+        return std::allocator<T>::allocate(n);}
+
+    void deallocate (T* p, std::size_t n) {
+        tagged_live[tag] -= n * sizeof(T);
+        std::allocator<T>::deallocate(p, n);}
+
+    friend bool operator == (const tagged_allocator& lhs, const tagged_allocator& rhs) {
+        return lhs.tag == rhs.tag;}
+
+    friend bool operator != (const tagged_allocator& lhs, const tagged_allocator& rhs) {
+        return lhs.tag != rhs.tag;}};
+
+template <bool CA, bool MA, bool SW>
+using tagged_deque = my_deque<std::string, tagged_allocator<std::string, CA, MA, SW>, 4>;
+
+template <typename D>
+void fill_tagged (D& x, int n, char c) {
+    for (int i = 0; i != n; ++i)
+        x.push_back(std::string(30, c));}
+
+// ---------------
+// Copy Assignment
+// ---------------
+
+TEST(TestDequeAllocator, Copy_Assign_1) {
+    typedef tagged_deque<true, false, false> deque_type;
+    {
+    deque_type x(tagged_allocator<std::string, true, false, false>(1));
+    deque_type y(tagged_allocator<std::string, true, false, false>(2));
+    fill_tagged(x, 20, 'a');
+    fill_tagged(y, 10, 'b');
+    x = y;
+    ASSERT_EQ(2, x.get_allocator().tag);
+    ASSERT_EQ(0, tagged_live[1]);
+    ASSERT_TRUE(x == y);}
+    ASSERT_EQ(0, tagged_live[1]);
+    ASSERT_EQ(0, tagged_live[2]);}
+
+TEST(TestDequeAllocator, Copy_Assign_2) {
+    typedef tagged_deque<false, false, false> deque_type;
+    {
+    deque_type x(tagged_allocator<std::string, false, false, false>(1));
+    deque_type y(tagged_allocator<std::string, false, false, false>(2));
+    fill_tagged(x, 20, 'a');
+    fill_tagged(y, 30, 'b');
+    const std::size_t n = x.block_allocations();
+    const std::string* p = &x[5];
+    x = y;
+    ASSERT_EQ(1, x.get_allocator().tag);
+    ASSERT_EQ(p, &x[5]);
+    ASSERT_EQ(n + 3, x.block_allocations());
+    ASSERT_TRUE(x == y);}
+    ASSERT_EQ(0, tagged_live[1]);
+    ASSERT_EQ(0, tagged_live[2]);}
+
+TEST(TestDequeAllocator, Copy_Assign_3) {
+    counted::copies = 0;
+    my_deque<counted, std::allocator<counted>, 4> x;
+    my_deque<counted, std::allocator<counted>, 4> y;
+    for (int i = 0; i != 10; ++i)
+        x.emplace_back(i);
+    for (int i = 0; i != 25; ++i)
+        y.emplace_back(-i);
+    x = y;
+    ASSERT_EQ(25, counted::copies);
+    ASSERT_EQ(-24, x.back().v);}
+
+// ---------------
+// Move Assignment
+// ---------------
+
+TEST(TestDequeAllocator, Move_Assign_1) {
+    typedef tagged_deque<false, true, false> deque_type;
+    {
+    deque_type x(tagged_allocator<std::string, false, true, false>(1));
+    deque_type y(tagged_allocator<std::string, false, true, false>(2));
+    fill_tagged(x, 20, 'a');
+    fill_tagged(y, 10, 'b');
+    const std::string* p = &y[3];
+    x = std::move(y);
+    ASSERT_EQ(2, x.get_allocator().tag);
+    ASSERT_EQ(p, &x[3]);
+    ASSERT_EQ(0, tagged_live[1]);
+    ASSERT_TRUE(y.empty());}
+    ASSERT_EQ(0, tagged_live[1]);
+    ASSERT_EQ(0, tagged_live[2]);}
+
+TEST(TestDequeAllocator, Move_Assign_2) {
+    typedef tagged_deque<false, false, false> deque_type;
+    {
+    deque_type x(tagged_allocator<std::string, false, false, false>(1));
+    deque_type y(tagged_allocator<std::string, false, false, false>(2));
+    fill_tagged(x, 20, 'a');
+    fill_tagged(y, 10, 'b');
+    x = std::move(y);
+    ASSERT_EQ(1, x.get_allocator().tag);
+    ASSERT_EQ(10, x.size());
+    ASSERT_EQ(std::string(30, 'b'), x.back());
+    ASSERT_TRUE(y.empty());}
+    ASSERT_EQ(0, tagged_live[1]);
+    ASSERT_EQ(0, tagged_live[2]);}
+
+// ----
+// Swap
+// ----
+
+TEST(TestDequeAllocator, Swap_1) {
+    typedef tagged_deque<false, false, true> deque_type;
+    {
+    deque_type x(tagged_allocator<std::string, false, false, true>(1));
+    deque_type y(tagged_allocator<std::string, false, false, true>(2));
+    fill_tagged(x, 20, 'a');
+    fill_tagged(y, 10, 'b');
+    const std::string* p = &x[7];
+    x.swap(y);
+    ASSERT_EQ(2, x.get_allocator().tag);
+    ASSERT_EQ(1, y.get_allocator().tag);
+    ASSERT_EQ(p, &y[7]);
+    ASSERT_EQ(10, x.size());}
+    ASSERT_EQ(0, tagged_live[1]);
+    ASSERT_EQ(0, tagged_live[2]);}
+
+TEST(TestDequeAllocator, Swap_2) {
+    typedef tagged_deque<false, false, false> deque_type;
+    {
+    deque_type x(tagged_allocator<std::string, false, false, false>(1));
+    deque_type y(tagged_allocator<std::string, false, false, false>(2));
+    fill_tagged(x, 20, 'a');
+    fill_tagged(y, 10, 'b');
+    x.swap(y);
+    ASSERT_EQ(1, x.get_allocator().tag);
+    ASSERT_EQ(2, y.get_allocator().tag);
+    ASSERT_EQ(10, x.size());
+    ASSERT_EQ(20, y.size());
+    ASSERT_EQ(std::string(30, 'a'), y.front());}
+    ASSERT_EQ(0, tagged_live[1]);
+    ASSERT_EQ(0, tagged_live[2]);}
+
+// *********** Growth ************ //
+
+// -----------------
+// Stable References
+// -----------------
+
+TEST(TestDequeGrowth, Stable_1) {
+    my_deque<int, std::allocator<int>, 4> x(1, 7);
+    const int* p = &x.front();
+    for (int i = 0; i != 10000; ++i) {
+        x.push_back(i);
+        x.push_front(-i);}
+    ASSERT_EQ(p, &x[10000]);
+    ASSERT_EQ(7, *p);}
+
+TEST(TestDequeGrowth, Stable_2) {
+    my_deque<std::string, std::allocator<std::string>, 2> x;
+    x.push_back("abc");
+    const std::string* p = &x.back();
+    for (int i = 0; i != 1000; ++i)
+        x.push_front("def");
+    ASSERT_EQ(p, &x.back());
+    ASSERT_EQ("abc", *p);}
+
+// -----------
+// No Relocate
+// -----------
+
+TEST(TestDequeGrowth, No_Relocate_1) {
+    counted::copies = 0;
+    counted::moves  = 0;
+    my_deque<counted, std::allocator<counted>, 4> x;
+    for (int i = 0; i != 500; ++i) {
+        x.emplace_back(i);
+        x.emplace_front(-i);}
+    ASSERT_EQ(0, counted::copies);
+    ASSERT_EQ(0, counted::moves);}
+
+// ----
+// FIFO
+// ----
+
+TEST(TestDequeGrowth, FIFO_1) {
+    my_deque<int, std::allocator<int>, 8> x;
+    for (int i = 0; i != 100000; ++i) {
+        x.push_back(i);
+        if (x.size() > 50) {
+            ASSERT_EQ(i - 50, x.front());
+            x.pop_front();}}
+    ASSERT_EQ(50, x.size());
+    ASSERT_EQ(99999, x.back());}
+
+// ------
+// Random
+// ------
+
+TEST(TestDequeGrowth, Random_1) {
+    my_deque<int, std::allocator<int>, 3> x;
+    std::deque<int>                       y;
+    unsigned r = 12345;
+    for (int i = 0; i != 20000; ++i) {
+        r = (r * 1103515245u) + 12345u;
+        const unsigned op = (r >> 16) % 9;
+        if (op == 0)
+            {x.push_back(i); y.push_back(i);}
+        else if (op == 1)
+            {x.push_front(i); y.push_front(i);}
+        else if ((op == 2) && !y.empty())
+            {x.pop_back(); y.pop_back();}
+        else if ((op == 3) && !y.empty())
+            {x.pop_front(); y.pop_front();}
+        else if (op == 4) {
+            const std::size_t k = (r >> 4) % (y.size() + 1);
+            x.insert(x.begin() + k, i);
+            y.insert(y.begin() + k, i);}
+        else if ((op == 5) && !y.empty()) {
+            const std::size_t k = (r >> 4) % y.size();
+            x.erase(x.begin() + k);
+            y.erase(y.begin() + k);}
+        else if (op == 6) {
+            const std::size_t k = (r >> 4) % (y.size() + 8);
+            x.resize(k, i);
+            y.resize(k, i);}
+        else if (op == 7)
+            {x.emplace_back(-i); y.emplace_back(-i);}
+        else
+            {x.emplace_front(-i); y.emplace_front(-i);}
+        ASSERT_EQ(y.size(), x.size());}
+    ASSERT_TRUE(std::equal(y.begin(), y.end(), x.begin()));}
+
+// *********** Lazy Blocks ************ //
+
+// ------------------
+// counting_allocator
+// ------------------
+
+struct allocation_counts {
+    static std::size_t allocations;
+    static std::size_t live;
+    static std::size_t peak;
+    static std::size_t maps;
+
+    static void reset () {
+        allocations = live = peak = maps = 0;}};
+
+std::size_t allocation_counts::allocations = 0;
+std::size_t allocation_counts::live        = 0;
+std::size_t allocation_counts::peak        = 0;
+std::size_t allocation_counts::maps        = 0;
+
+template <typename T>
+struct counting_allocator : std::allocator<T> {
+    template <typename U>
+    struct rebind {
+        typedef counting_allocator<U> other;};
+
+    counting_allocator () {}
+
+    template <typename U>
+    counting_allocator (const counting_allocator<U>&) {}
+
+    T* allocate (std::size_t n) {
+        if (std::is_pointer<T>::value)      // the map, rebound from the block allocator
+            ++allocation_counts::maps;
+        else {
+            ++allocation_counts::allocations;
+            allocation_counts::live += n * sizeof(T);
+            allocation_counts::peak  = std::max(allocation_counts::peak, allocation_counts::live);}
+        return std::allocator<T>::allocate(n);}
+
+    void deallocate (T* p, std::size_t n) {
+        if (!std::is_pointer<T>::value)
+            allocation_counts::live -= n * sizeof(T);
+        std::allocator<T>::deallocate(p, n);}};
+
+typedef my_deque<int, counting_allocator<int>, 4> counted_deque;
+
+// ---------------
+// Lazy Allocation
+// ---------------
+
+TEST(TestDequeLazy, Construct_1) {
+    allocation_counts::reset();
+    {
+    counted_deque x(10, 1);
+    ASSERT_EQ(3, allocation_counts::allocations);
+    ASSERT_EQ(1, allocation_counts::maps);
+    }
+    ASSERT_EQ(0, allocation_counts::live);}
+
+TEST(TestDequeLazy, Resize_1) {
+    allocation_counts::reset();
+    counted_deque x(2, 1);
+    x.resize(1000, 2);
+    ASSERT_EQ(250 * 4 * sizeof(int), allocation_counts::peak);
+    ASSERT_EQ(2, x[999]);}
+
+TEST(TestDequeLazy, Copy_1) {
+    counted_deque x(37, 5);
+    allocation_counts::reset();
+    counted_deque y(x);
+    ASSERT_EQ(10, allocation_counts::allocations);
+    ASSERT_TRUE(x == y);}
+
+// -------
+// Reserve
+// -------
+
+TEST(TestDequeLazy, Reserve_Back_1) {
+    counted_deque x(3, 1);
+    x.reserve_back(100);
+    const std::size_t a = allocation_counts::allocations;
+    for (int i = 0; i != 100; ++i)
+        x.push_back(i);
+    ASSERT_EQ(a, allocation_counts::allocations);
+    ASSERT_EQ(99, x.back());}
+
+TEST(TestDequeLazy, Reserve_Front_1) {
+    counted_deque x(3, 1);
+    x.reserve_front(100);
+    const std::size_t a = allocation_counts::allocations;
+    for (int i = 0; i != 100; ++i)
+        x.push_front(i);
+    ASSERT_EQ(a, allocation_counts::allocations);
+    ASSERT_EQ(99, x.front());
+    ASSERT_EQ(1, x.back());}
+
+TEST(TestDequeLazy, Reserve_Front_2) {
+    my_deque<int, std::allocator<int>, 4> x;
+    x.reserve_front(9);
+    x.reserve_back(9);
+    for (int i = 0; i != 9; ++i) {
+        x.push_front(-i);
+        x.push_back(i);}
+    ASSERT_EQ(18, x.size());
+    ASSERT_EQ(-8, x.front());
+    ASSERT_EQ(8, x.back());}
+
+// *********** Insert and Erase ************ //
+
+// ------------
+// Shorter Side
+// ------------
+
+TEST(TestDequeShift, Front_Side_1) {
+    my_deque<counted, std::allocator<counted>, 4> x;
+    for (int i = 0; i != 1000; ++i)
+        x.emplace_back(i);
+    counted::moves = 0;
+    x.insert(x.begin() + 2, counted(-1));
+    ASSERT_GE(5, counted::moves);
+    counted::moves = 0;
+    x.erase(x.end() - 3);
+    ASSERT_GE(3, counted::moves);
+    ASSERT_EQ(-1, x[2].v);
+    ASSERT_EQ(2, x[3].v);
+    ASSERT_EQ(999, x.back().v);}
+
+TEST(TestDequeShift, Front_Side_2) {
+    my_deque<counted, std::allocator<counted>, 4> x;
+    for (int i = 0; i != 1000; ++i)
+        x.emplace_back(i);
+    counted::moves = counted::copies = 0;
+    const counted a[] = {counted(-1), counted(-2), counted(-3)};
+    x.insert(x.begin() + 5, a, a + 3);
+    x.erase(x.begin() + 1, x.begin() + 4);
+    ASSERT_GE(20, counted::moves + counted::copies);
+    ASSERT_EQ(1000, x.size());
+    ASSERT_EQ(4, x[1].v);
+    ASSERT_EQ(-1, x[2].v);}
+
+// ------
+// Random
+// ------
+
+TEST(TestDequeShift, Random_1) {
+    my_deque<std::string, std::allocator<std::string>, 3> x;
+    std::deque<std::string>                               y;
+    unsigned r = 777;
+    for (int i = 0; i != 3000; ++i) {
+        r = (r * 1103515245u) + 12345u;
+        const std::size_t k = (r >> 8) % (y.size() + 1);
+        const std::size_t n = (r >> 20) % 12;
+        const std::string v(1 + (i % 40), 'a' + (i % 26));
+        if ((r >> 4) % 3 == 0) {
+            std::vector<std::string> a(n, v);
+            x.insert(x.begin() + k, a.begin(), a.end());
+            if (n != 0)                                      // libstdc++ self-moves on n == 0
+                y.insert(y.begin() + k, a.begin(), a.end());}
+        else if ((r >> 4) % 3 == 1) {
+            x.insert(x.begin() + k, n, v);
+            if (n != 0)
+                y.insert(y.begin() + k, n, v);}
+        else {
+            const std::size_t m = std::min(n, y.size() - k);
+            x.erase(x.begin() + k, x.begin() + k + m);
+            y.erase(y.begin() + k, y.begin() + k + m);}
+        ASSERT_EQ(y.size(), x.size());}
+    ASSERT_TRUE(std::equal(y.begin(), y.end(), x.begin()));}
+
+// *********** Block Recycling ************ //
+
+// ----
+// FIFO
+// ----
+
+TEST(TestDequeRecycle, FIFO_1) {
+    my_deque<int, std::allocator<int>, 4> x;
+    for (int i = 0; i != 100; ++i)
+        x.push_back(i);
+    for (int i = 0; i != 1000; ++i) {
+        x.push_back(i);
+        x.pop_front();}
+    const std::size_t a = x.block_allocations();
+    for (int i = 0; i != 10000; ++i) {
+        x.push_back(i);
+        x.pop_front();}
+    ASSERT_EQ(a, x.block_allocations());
+    ASSERT_EQ(100, x.size());
+    ASSERT_EQ(9900, x.front());}
+
+TEST(TestDequeRecycle, FIFO_2) {
+    my_deque<int, std::allocator<int>, 4> x;
+    for (int i = 0; i != 100; ++i)
+        x.push_front(i);
+    for (int i = 0; i != 1000; ++i) {
+        x.push_front(i);
+        x.pop_back();}
+    const std::size_t a = x.block_allocations();
+    for (int i = 0; i != 10000; ++i) {
+        x.push_front(i);
+        x.pop_back();}
+    ASSERT_EQ(a, x.block_allocations());
+    ASSERT_EQ(9999, x.front());}
+
+TEST(TestDequeRecycle, FIFO_3) {
+    allocation_counts::reset();
+    counted_deque x;
+    for (int i = 0; i != 10000; ++i) {
+        x.push_back(i);
+        if (i >= 20)
+            x.pop_front();}
+    ASSERT_GE((5 + 1 + 2) * 4 * sizeof(int), allocation_counts::live);
+    ASSERT_GE(x.block_allocations() * 4 * sizeof(int), allocation_counts::peak);}
+
+// ------
+// Spares
+// ------
+
+TEST(TestDequeRecycle, Spares_1) {
+    my_deque<int, std::allocator<int>, 4> x;
+    ASSERT_EQ(2, x.max_spare_blocks());
+    for (int i = 0; i != 100; ++i)
+        x.push_back(i);
+    ASSERT_EQ(0, x.spare_blocks());
+    for (int i = 0; i != 99; ++i)
+        x.pop_front();
+    ASSERT_EQ(2, x.spare_blocks());
+    x.clear();
+    ASSERT_EQ(2, x.spare_blocks());
+    for (int i = 0; i != 12; ++i)
+        x.push_back(i);
+    ASSERT_EQ(0, x.spare_blocks());}
+
+TEST(TestDequeRecycle, Spares_2) {
+    my_deque<int, std::allocator<int>, 4> x;
+    x.max_spare_blocks(0);
+    for (int i = 0; i != 100; ++i)
+        x.push_back(i);
+    x.erase(x.begin(), x.begin() + 50);
+    x.resize(10);
+    ASSERT_EQ(0, x.spare_blocks());
+    ASSERT_EQ(50, x.front());
+    ASSERT_EQ(59, x.back());}
+
+TEST(TestDequeRecycle, Spares_3) {
+    my_deque<std::string, std::allocator<std::string>, 4> x(5, "abc");
+    x.max_spare_blocks(10);
+    x.reserve_back(100);
+    x.reserve_front(100);
+    ASSERT_EQ(0, x.spare_blocks());
+    for (int i = 0; i != 50; ++i)
+        x.push_front("def");
+    for (int i = 0; i != 50; ++i)
+        x.pop_front();
+    ASSERT_EQ(10, x.spare_blocks());
+    x.max_spare_blocks(3);
+    ASSERT_EQ(3, x.spare_blocks());
+    ASSERT_EQ(3, x.max_spare_blocks());
+    ASSERT_EQ(5, x.size());
+    ASSERT_EQ("abc", x.front());}
+
+TEST(TestDequeRecycle, Spares_4) {
+    my_deque<int, std::allocator<int>, 4> x;
+    x.max_spare_blocks(100);
+    for (int i = 0; i != 100; ++i)
+        x.push_back(i);
+    while (x.size() != 1)
+        x.pop_back();
+    ASSERT_EQ(24, x.spare_blocks());
+    const std::size_t a = x.block_allocations();
+    for (int i = 0; i != 96; ++i)
+        x.push_front(i);
+    ASSERT_EQ(a, x.block_allocations());
+    ASSERT_EQ(0, x.spare_blocks());}
+
+// *********** Shrinking ************ //
+
+/**
+ * Resident set size of this process in bytes, 0 if unknown.
+ */
+std::size_t resident_bytes () {
+    std::ifstream in("/proc/self/statm");
+    std::size_t pages = 0;
+    std::size_t resident = 0;
+    in >> pages >> resident;
+    return resident * ::sysconf(_SC_PAGESIZE);}
+
+// -------------
+// Shrink_To_Fit
+// -------------
+
+TEST(TestDequeShrink, Shrink_To_Fit_1) {
+    allocation_counts::reset();
+    counted_deque x;
+    for (int i = 0; i != 10000; ++i)
+        x.push_back(i);
+    x.reserve_front(100);
+    for (int i = 0; i != 9990; ++i)
+        x.pop_front();
+    const int* const p = &x[3];
+    x.shrink_to_fit();
+    ASSERT_EQ(p, &x[3]);
+    ASSERT_EQ(9993, x[3]);
+    ASSERT_EQ(0, x.spare_blocks());
+    ASSERT_GE(3 * 4 * sizeof(int), allocation_counts::live);
+    x.push_front(-1);
+    x.push_back(10000);
+    ASSERT_EQ(12, x.size());
+    ASSERT_EQ(-1, x.front());
+    ASSERT_EQ(10000, x.back());}
+
+TEST(TestDequeShrink, Shrink_To_Fit_2) {
+    allocation_counts::reset();
+    {
+    counted_deque x(1000, 2);
+    x.clear();
+    x.shrink_to_fit();
+    ASSERT_EQ(0, allocation_counts::live);
+    x.shrink_to_fit();
+    x.push_front(5);
+    ASSERT_EQ(5, x.back());
+    }
+    ASSERT_EQ(0, allocation_counts::live);}
+
+// ----
+// Auto
+// ----
+
+TEST(TestDequeShrink, Auto_1) {
+    allocation_counts::reset();
+    counted_deque x;
+    x.auto_shrink(true);
+    ASSERT_TRUE(x.auto_shrink());
+    for (int i = 0; i != 40000; ++i)
+        x.push_back(i);
+    const std::size_t full = allocation_counts::live;
+    for (int i = 0; i != 39990; ++i)
+        x.pop_front();
+    ASSERT_GT(full / 100, allocation_counts::live);
+    ASSERT_EQ(39990, x.front());
+    ASSERT_EQ(39999, x.back());
+    counted_deque y(x);
+    ASSERT_TRUE(y.auto_shrink());}
+
+TEST(TestDequeShrink, Auto_2) {
+    counted_deque x;
+    x.auto_shrink(true);
+    for (int i = 0; i != 400; ++i)
+        x.push_back(i);
+    allocation_counts::reset();
+    for (int k = 0; k != 100; ++k) {
+        for (int i = 0; i != 200; ++i)
+            x.pop_back();
+        for (int i = 0; i != 200; ++i)
+            x.push_back(i);}
+    ASSERT_GE(2, allocation_counts::maps);
+    ASSERT_EQ(400, x.size());}
+
+// ---
+// RSS
+// ---
+
+TEST(TestDequeShrink, RSS_1) {
+    my_deque<int> x;
+    x.append_n(1 << 24, [] () {return 1;});
+    const std::size_t full = resident_bytes();
+    x.resize(10);
+    x.shrink_to_fit();
+#ifdef __GLIBC__
+    ::malloc_trim(0);
+#endif
+    const std::size_t after = resident_bytes();
+#if !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+    if (full != 0) {
+        ASSERT_GT(full - (32 << 20), after);}
+#endif
+    ASSERT_EQ(10, x.size());}
+
+// *********** Trivially Copyable ************ //
+
+struct point {
+    int    x;
+    double y;};
+
+// ------
+// Traits
+// ------
+
+TEST(TestDequeTrivial, Traits_1) {
+    ASSERT_TRUE ((my_deque_trivial_copy<std::allocator<int> >::value));
+    ASSERT_TRUE ((my_deque_trivial_copy<std::allocator<point> >::value));
+    ASSERT_FALSE((my_deque_trivial_copy<std::allocator<std::string> >::value));
+    ASSERT_FALSE((my_deque_trivial_copy<std::allocator<counted> >::value));
+    ASSERT_FALSE((my_deque_trivial_copy<counting_allocator<int> >::value));}
+
+TEST(TestDequeTrivial, Traits_2) {
+    ASSERT_TRUE ((my_deque_trivial_destroy<std::allocator<double> >::value));
+    ASSERT_TRUE ((my_deque_trivial_destroy<std::allocator<counted> >::value));
+    ASSERT_FALSE((my_deque_trivial_destroy<std::allocator<std::string> >::value));
+    ASSERT_FALSE((my_deque_trivial_destroy<counting_allocator<int> >::value));}
+
+// ----
+// Copy
+// ----
+
+TEST(TestDequeTrivial, Copy_1) {
+    my_deque<point, std::allocator<point>, 5> x;
+    for (int i = 0; i != 50; ++i) {
+        const point p = {i, i / 2.0};
+        x.push_front(p);}
+    x.pop_back();
+    my_deque<point, std::allocator<point>, 5> y(x);
+    ASSERT_EQ(49, y.size());
+    for (int i = 0; i != 49; ++i) {
+        ASSERT_EQ(49 - i, y[i].x);
+        ASSERT_EQ((49 - i) / 2.0, y[i].y);}}
+
+TEST(TestDequeTrivial, Copy_2) {
+    my_deque<int, std::allocator<int>, 7> x;
+    my_deque<int, std::allocator<int>, 7> y;
+    for (int i = 0; i != 40; ++i) {
+        x.push_back(i);
+        y.push_front(-i);}
+    y.pop_front();
+    y = x;
+    ASSERT_TRUE(std::equal(x.begin(), x.end(), y.begin()));
+    x.resize(5);
+    y = x;
+    ASSERT_EQ(5, y.size());
+    ASSERT_EQ(4, y.back());}
+
+// -----------
+// Non-trivial
+// -----------
+
+TEST(TestDequeTrivial, Counted_1) {
+    my_deque<counted, std::allocator<counted>, 3> x;
+    for (int i = 0; i != 10; ++i)
+        x.emplace_back(i);
+    counted::copies = 0;
+    my_deque<counted, std::allocator<counted>, 3> y(x);
+    ASSERT_EQ(10, counted::copies);
+    y = x;
+    ASSERT_EQ(20, counted::copies);
+    ASSERT_EQ(9, y.back().v);}
+
+// *********** Bulk Append ************ //
+
+// -----
+// fussy
+// -----
+
+/**
+ * Throws once the copy countdown reaches zero.
+ */
+struct fussy {
+    static int countdown;
+
+    int v;
+
+    fussy (int i) : v(i) {}
+    fussy (const fussy& rhs) : v(rhs.v) {
+        if (--countdown == 0)
+            throw std::invalid_argument("fussy");}};
+
+int fussy::countdown = 0;
+
+// ------
+// Append
+// ------
+
+typedef my_deque<int, std::allocator<int>, 16> bulk_deque;
+
+TEST(TestDequeBulk, Append_1) {
+    bulk_deque x(3, 7);
+    std::vector<int> v;
+    for (int i = 0; i != 1000; ++i)
+        v.push_back(i);
+    x.append(v.data(), v.data() + v.size());
+    ASSERT_EQ(1003, x.size());
+    ASSERT_EQ(7, x[2]);
+    ASSERT_TRUE(std::equal(v.begin(), v.end(), x.begin() + 3));}
+
+TEST(TestDequeBulk, Append_2) {
+    bulk_deque x;
+    std::istringstream in("1 2 3 4 5");
+    x.append(std::istream_iterator<int>(in), std::istream_iterator<int>());
+    ASSERT_EQ(5, x.size());
+    ASSERT_EQ(1, x.front());
+    ASSERT_EQ(5, x.back());}
+
+TEST(TestDequeBulk, Append_3) {
+    bulk_deque x(1, 9);
+    int i = 0;
+    x.append_n(600, [&] () {return i++;});
+    ASSERT_EQ(601, x.size());
+    ASSERT_EQ(0, x[1]);
+    ASSERT_EQ(599, x.back());}
+
+// -------
+// Prepend
+// -------
+
+TEST(TestDequeBulk, Prepend_1) {
+    bulk_deque x(2, 7);
+    std::vector<int> v;
+    for (int i = 0; i != 1000; ++i)
+        v.push_back(i);
+    x.prepend(v.begin(), v.end());
+    ASSERT_EQ(1002, x.size());
+    ASSERT_TRUE(std::equal(v.begin(), v.end(), x.begin()));
+    ASSERT_EQ(7, x.back());}
+
+TEST(TestDequeBulk, Prepend_2) {
+    bulk_deque x(1, 0);
+    std::istringstream in("1 2 3");
+    x.prepend(std::istream_iterator<int>(in), std::istream_iterator<int>());
+    ASSERT_EQ(4, x.size());
+    ASSERT_EQ(1, x[0]);
+    ASSERT_EQ(3, x[2]);
+    ASSERT_EQ(0, x[3]);}
+
+// ------
+// Blocks
+// ------
+
+TEST(TestDequeBulk, Blocks_1) {
+    allocation_counts::reset();
+    counted_deque x;
+    std::vector<int> v(4096, 3);
+    x.append(v.data(), v.data() + v.size());
+    ASSERT_EQ(1024, allocation_counts::allocations);
+    ASSERT_EQ(1, allocation_counts::maps);
+    x.prepend(v.data(), v.data() + 10);
+    ASSERT_EQ(1027, allocation_counts::allocations);
+    ASSERT_EQ(2, allocation_counts::maps);
+    ASSERT_EQ(4106, x.size());}
+
+TEST(TestDequeBulk, Mixed_1) {
+    my_deque<int, std::allocator<int>, 5> x;
+    std::deque<int>                       y;
+    int i = 0;
+    for (int k = 0; k != 200; ++k) {
+        std::vector<int> v;
+        for (int j = 0; j != (k % 13); ++j)
+            v.push_back(i++);
+        if ((k % 3) == 0) {
+            x.prepend(v.begin(), v.end());
+            y.insert(y.begin(), v.begin(), v.end());}
+        else {
+            x.append(v.data(), v.data() + v.size());
+            y.insert(y.end(), v.begin(), v.end());}
+        if (((k % 7) == 0) && !y.empty()) {
+            x.pop_front();
+            y.pop_front();}}
+    ASSERT_EQ(y.size(), x.size());
+    ASSERT_TRUE(std::equal(y.begin(), y.end(), x.begin()));}
+
+// ---------
+// Exception
+// ---------
+
+TEST(TestDequeBulk, Exception_1) {
+    my_deque<fussy, std::allocator<fussy>, 4> x;
+    std::vector<fussy> v(10, fussy(1));
+    x.push_back(fussy(0));
+    fussy::countdown = 7;
+    ASSERT_THROW(x.append(v.begin(), v.end()), std::invalid_argument);
+    ASSERT_EQ(1, x.size());
+    fussy::countdown = 7;
+    ASSERT_THROW(x.prepend(v.begin(), v.end()), std::invalid_argument);
+    ASSERT_EQ(1, x.size());
+    ASSERT_EQ(0, x.front().v);
+    fussy::countdown = 0;
+    x.prepend(v.begin(), v.end());
+    ASSERT_EQ(11, x.size());
+    ASSERT_EQ(0, x.back().v);}
+
+TEST(TestDequeBulk, Exception_2) {
+    my_deque<std::string, std::allocator<std::string>, 4> x(2, "a");
+    int i = 0;
+    ASSERT_THROW(x.append_n(9, [&] () -> std::string {
+        if (++i == 6)
+            throw std::invalid_argument("append_n");
+        return std::string(50, 'b');}),
+        std::invalid_argument);
+    ASSERT_EQ(2, x.size());
+    ASSERT_EQ("a", x.back());}
+
+// *********** Segments ************ //
+
+TEST(TestDequeSegments, View_1) {
+    my_deque<int, std::allocator<int>, 8> x;
+    for (int i = 0; i != 50; ++i) {
+        x.push_back(i);
+        x.push_front(-i);}
+    std::vector<int> v;
+    int n = 0;
+    for (const auto& s : x.segments()) {
+        ASSERT_LT(0, s.size);
+        ASSERT_GE(8, s.size);
+        v.insert(v.end(), s.begin(), s.end());
+        ++n;}
+    ASSERT_TRUE(std::equal(v.begin(), v.end(), x.begin()));
+    ASSERT_EQ(100, v.size());
+    ASSERT_EQ(14, n);}
+
+TEST(TestDequeSegments, View_2) {
+    my_deque<int, std::allocator<int>, 8> x;
+    ASSERT_TRUE(x.segments().begin() == x.segments().end());
+    for (int i = 0; i != 40; ++i)
+        x.push_back(i);
+    int n = 0;
+    for (const auto& s : x.segments(x.begin() + 5, x.begin() + 19)) {
+        for (int* p = s.begin(); p != s.end(); ++p)
+            *p = 0;
+        ++n;}
+    ASSERT_EQ(3, n);
+    ASSERT_EQ(4, x[4]);
+    ASSERT_EQ(0, x[5]);
+    ASSERT_EQ(0, x[18]);
+    ASSERT_EQ(19, x[19]);}
+
+TEST(TestDequeSegments, Compare_1) {
+    my_deque<int, std::allocator<int>, 8> x;
+    my_deque<int, std::allocator<int>, 8> y;
+    for (int i = 0; i != 100; ++i) {
+        x.push_back(i);
+        y.push_front(99 - i);}
+    ASSERT_TRUE(x == y);
+    ASSERT_FALSE(x < y);
+    y.back() = 100;
+    ASSERT_TRUE(x < y);
+    y.back() = 99;
+    y.push_back(0);
+    ASSERT_TRUE(x < y);
+    ASSERT_FALSE(y < x);
+    x[3] = 4;
+    ASSERT_TRUE(y < x);}
+
+template <int D>
+struct far_int {
+    int v;};
+
+template <int D>
+struct my_deque_prefetch_distance<far_int<D> > {
+    static const std::size_t value = D;};
+
+template <int D>
+void prefetch_ranges () {
+    my_deque<far_int<D>, std::allocator<far_int<D> >, 8> x;
+    ASSERT_TRUE(x.segments().begin() == x.segments().end());
+    for (int i = 0; i != 30; ++i) {
+        const far_int<D> v = {i};
+        x.push_back(v);}
+    for (int i = 0; i != 7; ++i)
+        x.pop_front();
+    for (int b = 0; b <= 23; ++b)
+        for (int e = b; e <= 23; ++e) {
+            int n = 0;
+            for (const auto& s : x.segments(x.begin() + b, x.begin() + e))
+                for (const far_int<D>* p = s.begin(); p != s.end(); ++p) {
+                    ASSERT_EQ(b + 7 + n, p->v);
+                    ++n;}
+            ASSERT_EQ(e - b, n);}}
+
+TEST(TestDequeSegments, Prefetch_1) {
+    prefetch_ranges<0>();
+    prefetch_ranges<1>();
+    prefetch_ranges<3>();
+    prefetch_ranges<64>();}
+
+// *********** Block Pool ************ //
+
+typedef my_deque<int, block_pool_allocator<int>, 8> pool_deque;
+
+// ----
+// Pool
+// ----
+
+TEST(TestBlockPool, Pool_1) {
+    block_pool p(64);
+    void* const a = p.allocate();
+    void* const b = p.allocate();
+    p.deallocate(a);
+    p.deallocate(b);
+    ASSERT_EQ(2, p.cached());
+    ASSERT_EQ(b, p.allocate());
+    ASSERT_EQ(a, p.allocate());
+    ASSERT_EQ(0, p.cached());
+    p.deallocate(a);
+    p.deallocate(b);}
+
+TEST(TestBlockPool, Pool_2) {
+    block_pool p(64, 4);
+    std::vector<void*> v;
+    for (int i = 0; i != 10; ++i)
+        v.push_back(p.allocate());
+    for (int i = 0; i != 10; ++i)
+        p.deallocate(v[i]);
+    ASSERT_GE(4, p.cached());}
+
+// -----
+// Arena
+// -----
+
+TEST(TestBlockPool, Arena_1) {
+    block_arena r(64);
+    block_pool  p(r, 4);
+    std::vector<void*> v;
+    for (int i = 0; i != 10; ++i)
+        v.push_back(p.allocate());
+    for (int i = 0; i != 10; ++i)
+        p.deallocate(v[i]);
+    ASSERT_EQ(10, p.cached() + r.cached());
+    ASSERT_LT(0, r.cached());
+    void* const a = p.allocate();
+    p.deallocate(a);
+    ASSERT_EQ(10, p.cached() + r.cached());}
+
+TEST(TestBlockPool, Arena_2) {
+    block_arena r(64);
+    block_pool* p = &r.local();
+    ASSERT_EQ(p, &r.local());
+    block_pool* q = 0;
+    std::thread t([&] () {q = &r.local();});
+    t.join();
+    ASSERT_NE(p, q);}
+
+// ---------
+// Allocator
+// ---------
+
+TEST(TestBlockPool, Allocator_1) {
+    block_pool p(block_bytes<pool_deque>::value);
+    {
+    pool_deque x((block_pool_allocator<int>(p)));
+    for (int i = 0; i != 100; ++i)
+        x.push_back(i);
+    ASSERT_EQ(0, p.cached());}
+    const std::size_t n = p.cached();
+    ASSERT_LE(13, n);
+    {
+    pool_deque x((block_pool_allocator<int>(p)));
+    for (int i = 0; i != 100; ++i)
+        x.push_back(i);
+    ASSERT_EQ(0, p.cached());}
+    ASSERT_EQ(n, p.cached());}
+
+TEST(TestBlockPool, Allocator_2) {
+    block_arena r(block_bytes<pool_deque>::value);
+    const block_pool_allocator<int> a(r);
+    std::vector<std::thread> v;
+    for (int t = 0; t != 4; ++t)
+        v.push_back(std::thread([&a] () {
+            for (int k = 0; k != 50; ++k) {
+                pool_deque x(a);
+                for (int i = 0; i != 200; ++i)
+                    x.push_back(i);
+                for (int i = 0; i != 150; ++i)
+                    x.pop_front();
+                pool_deque y(x);
+                ASSERT_EQ(50, y.size());
+                ASSERT_EQ(150, y.front());}}));
+    for (int t = 0; t != 4; ++t)
+        v[t].join();
+    ASSERT_LT(0, r.cached());}
+
+TEST(TestBlockPool, Allocator_3) {
+    block_pool p(block_bytes<pool_deque>::value);
+    pool_deque x((block_pool_allocator<int>(p)));
+    pool_deque y;
+    for (int i = 0; i != 20; ++i) {
+        x.push_back(i);
+        y.push_back(-i);}
+    x.swap(y);
+    ASSERT_EQ(-19, x.back());
+    ASSERT_EQ(19, y.back());}
+
+// *********** SPSC Deque ************ //
+
+// ------
+// Single
+// ------
+
+TEST(TestSPSCDeque, Single_1) {
+    spsc_deque<int, std::allocator<int>, 4> x;
+    ASSERT_TRUE(x.empty());
+    ASSERT_EQ(0, x.front());
+    for (int i = 0; i != 10; ++i)
+        x.push_back(i);
+    ASSERT_EQ(10, x.size());
+    for (int i = 0; i != 10; ++i) {
+        int v = -1;
+        ASSERT_TRUE(x.pop_front(v));
+        ASSERT_EQ(i, v);}
+    int v = -1;
+    ASSERT_FALSE(x.pop_front(v));
+    ASSERT_EQ(-1, v);}
+
+TEST(TestSPSCDeque, Single_2) {
+    spsc_deque<std::string, std::allocator<std::string>, 3> x;
+    x.push_back(std::string(50, 'a'));
+    x.emplace_back(20, 'b');
+    ASSERT_EQ(std::string(50, 'a'), *x.front());
+    x.pop_front();
+    ASSERT_EQ(std::string(20, 'b'), *x.front());
+    for (int i = 0; i != 10; ++i)
+        x.push_back("c");}
+
+TEST(TestSPSCDeque, Recycle_1) {
+    spsc_deque<int, std::allocator<int>, 4> x;
+    for (int k = 0; k != 100; ++k) {
+        for (int i = 0; i != 20; ++i)
+            x.push_back(i);
+        while (!x.empty())
+            x.pop_front();}
+    ASSERT_GE(7, x.block_allocations());}
+
+// ------
+// Stress
+// ------
+
+TEST(TestSPSCDeque, Stress_1) {
+    const int n = 1000000;
+    spsc_deque<int, std::allocator<int>, 16> x;
+    std::thread c([&] () {
+        for (int i = 0; i != n;) {
+            int v;
+            if (x.pop_front(v)) {
+                ASSERT_EQ(i, v);
+                ++i;}}});
+    for (int i = 0; i != n; ++i)
+        x.push_back(i);
+    c.join();
+    ASSERT_TRUE(x.empty());}
+
+TEST(TestSPSCDeque, Stress_2) {
+    const int n = 100000;
+    spsc_deque<std::string, std::allocator<std::string>, 3> x;
+    std::thread c([&] () {
+        for (int i = 0; i != n;) {
+            if (const std::string* p = x.front()) {
+                ASSERT_EQ(std::string(20 + (i % 7), 'a' + (i % 26)), *p);
+                x.pop_front();
+                ++i;}}});
+    for (int i = 0; i != n; ++i)
+        x.emplace_back(20 + (i % 7), 'a' + (i % 26));
+    c.join();
+    ASSERT_TRUE(x.empty());}
+
+TEST(TestSPSCDeque, Stress_3) {
+    const int n = 200000;
+    spsc_deque<int, std::allocator<int>, 8> x;
+    std::thread c([&] () {
+        for (int i = 0; i != n;) {
+            int v;
+            if (x.pop_front(v)) {
+                ASSERT_EQ(i, v);
+                ++i;}}});
+    for (int i = 0; i != n; ++i) {
+        x.push_back(i);
+        if ((i % 1000) == 0)
+            while (!x.empty()) {}}
+    c.join();
+    ASSERT_GE(n / 8, x.block_allocations());}
+
+// *********** Work-Stealing Deque ************ //
+
+// -----
+// Owner
+// -----
+
+TEST(TestWorkStealingDeque, Owner_1) {
+    work_stealing_deque<int, std::allocator<int>, 4> x;
+    int v = -1;
+    ASSERT_FALSE(x.pop_back(v));
+    ASSERT_FALSE(x.steal_front(v));
+    for (int i = 0; i != 100; ++i)
+        x.push_back(i);
+    ASSERT_EQ(100, x.size());
+    ASSERT_LE(100, x.capacity());
+    ASSERT_TRUE(x.pop_back(v));
+    ASSERT_EQ(99, v);
+    ASSERT_TRUE(x.steal_front(v));
+    ASSERT_EQ(0, v);
+    ASSERT_EQ(98, x.size());}
+
+TEST(TestWorkStealingDeque, Owner_2) {
+    work_stealing_deque<int, std::allocator<int>, 4> x;
+    for (int k = 0; k != 50; ++k) {
+        for (int i = 0; i != 7; ++i)
+            x.push_back(i);
+        int v;
+        ASSERT_TRUE(x.steal_front(v));
+        ASSERT_EQ(0, v);
+        for (int i = 6; i != 0; --i) {
+            ASSERT_TRUE(x.pop_back(v));
+            ASSERT_EQ(i, v);}
+        ASSERT_TRUE(x.empty());}
+    ASSERT_GE(16, x.capacity());}
+
+// ------
+// Stress
+// ------
+
+TEST(TestWorkStealingDeque, Stress_1) {
+    const int n = 200000;
+    work_stealing_deque<int, std::allocator<int>, 8> x;
+    std::vector< std::atomic<int> > seen(n);
+    for (int i = 0; i != n; ++i)
+        seen[i].store(0);
+    std::atomic<bool> done(false);
+    std::vector<std::thread> thieves;
+    for (int k = 0; k != 3; ++k)
+        thieves.push_back(std::thread([&] () {
+            int v;
+            while (!done.load())
+                if (x.steal_front(v))
+                    seen[v].fetch_add(1);}));
+    int v;
+    for (int i = 0; i != n; ++i) {
+        x.push_back(i);
+        if (((i % 3) == 0) && x.pop_back(v))
+            seen[v].fetch_add(1);}
+    while (x.pop_back(v))
+        seen[v].fetch_add(1);
+    done.store(true);
+    for (int k = 0; k != 3; ++k)
+        thieves[k].join();
+    for (int i = 0; i != n; ++i)
+        ASSERT_EQ(1, seen[i].load());}
+
+// ----
+// Pool
+// ----
+
+TEST(TestWorkStealingPool, Submit_1) {
+    std::atomic<int> sum(0);
+    {
+    work_stealing_pool p(4);
+    ASSERT_EQ(4, p.size());
+    for (int i = 1; i <= 1000; ++i)
+        p.submit([&sum, i] () {sum.fetch_add(i);});
+    p.wait();
+    ASSERT_EQ(500500, sum.load());
+    }}
+
+/**
+ * Counts the leaves of a binary tree of the given depth, spawning one
+ * task per node.
+ */
+void count_leaves (work_stealing_pool& p, int depth, std::atomic<int>& leaves) {
+    if (depth == 0) {
+        leaves.fetch_add(1);
+        return;}
+    p.spawn([&p, depth, &leaves] () {count_leaves(p, depth - 1, leaves);});
+    p.spawn([&p, depth, &leaves] () {count_leaves(p, depth - 1, leaves);});}
+
+TEST(TestWorkStealingPool, Spawn_1) {
+    std::atomic<int> leaves(0);
+    work_stealing_pool p(3);
+    p.submit([&] () {count_leaves(p, 14, leaves);});
+    p.wait();
+    ASSERT_EQ(1 << 14, leaves.load());}
+
+// *********** Parallel Algorithms ************ //
+
+typedef my_deque<int, std::allocator<int>, 64> parallel_deque;
+
+// --------
+// for_each
+// --------
+
+TEST(TestDequeParallel, For_Each_1) {
+    work_stealing_pool p(3);
+    parallel_deque x;
+    for (int i = 0; i != 10000; ++i)
+        x.push_front(i);
+    for_each(par(p), x, [] (int& v) {v = (2 * v) + 1;});
+    for (int i = 0; i != 10000; ++i)
+        ASSERT_EQ((2 * (9999 - i)) + 1, x[i]);}
+
+TEST(TestDequeParallel, Chunks_1) {
+    work_stealing_pool p(2);
+    parallel_deque x;
+    for (int i = 0; i != 1000; ++i)
+        x.push_front(i);
+    const std::vector<std::size_t> c = parallel_chunks(par(p, 100), x);
+    ASSERT_EQ(0, c.front());
+    ASSERT_EQ(1000, c.back());
+    const std::size_t f = 1000 % 64;
+    for (std::size_t i = 1; i != c.size() - 1; ++i) {
+        ASSERT_LE(100, c[i] - c[i - 1]);
+        ASSERT_EQ(f, c[i] % 64);}}
+
+// ---------
+// transform
+// ---------
+
+TEST(TestDequeParallel, Transform_1) {
+    work_stealing_pool p(4);
+    parallel_deque x;
+    for (int i = 0; i != 5000; ++i)
+        x.push_back(i);
+    my_deque<double, std::allocator<double>, 48> y(7, 0.5);
+    y.pop_front();
+    transform(par(p, 10), x, y, [] (int v) {return v / 2.0;});
+    ASSERT_EQ(5000, y.size());
+    for (int i = 0; i != 5000; ++i)
+        ASSERT_EQ(i / 2.0, y[i]);}
+
+// ------
+// reduce
+// ------
+
+TEST(TestDequeParallel, Reduce_1) {
+    work_stealing_pool p(3);
+    parallel_deque x;
+    ASSERT_EQ(7, reduce(par(p), x, 7));
+    for (int i = 1; i <= 20000; ++i)
+        x.push_back(i);
+    ASSERT_EQ(200010007LL, reduce(par(p), x, 7LL));
+    ASSERT_EQ(20000, reduce(par(p, 1), x, 0, [] (int a, int b) {return std::max(a, b);}));}
+
+// ----
+// sort
+// ----
+
+TEST(TestDequeParallel, Sort_1) {
+    work_stealing_pool p(4);
+    parallel_deque x;
+    std::vector<int> v;
+    unsigned r = 777;
+    for (int i = 0; i != 30000; ++i) {
+        r = (r * 1103515245) + 12345;
+        const int k = (r >> 8) % 5000;
+        x.push_front(k);
+        v.push_back(k);}
+    sort(par(p, 100), x);
+    std::sort(v.begin(), v.end());
+    ASSERT_TRUE(std::equal(v.begin(), v.end(), x.begin()));
+    sort(par(p), x, [] (int a, int b) {return b < a;});
+    ASSERT_TRUE(std::equal(v.rbegin(), v.rend(), x.begin()));}
+
+TEST(TestDequeParallel, Sort_2) {
+    work_stealing_pool p(2);
+    my_deque<std::string, std::allocator<std::string>, 8> x;
+    for (int i = 0; i != 500; ++i)
+        x.push_back(std::to_string((i * 7919) % 500));
+    sort(par(p, 1), x);
+    ASSERT_TRUE(std::is_sorted(x.begin(), x.end()));
+    ASSERT_EQ(500, x.size());}
+
+// *********** Mapped Deque ************ //
+
+/**
+ * A scratch file name, removed before and after each use.
+ */
+struct scratch_file {
+    const std::string path;
+
+    explicit scratch_file (const std::string& name) : path("/tmp/TestDeque_" + name + ".bin") {
+        std::remove(path.c_str());}
+
+    ~scratch_file () {
+        std::remove(path.c_str());}};
+
+// ----
+// Ends
+// ----
+
+TEST(TestMappedDeque, Ends_1) {
+    scratch_file f("Ends_1");
+    mapped_deque<int, 8> x(f.path);
+    ASSERT_TRUE(x.empty());
+    for (int i = 0; i != 20; ++i) {
+        x.push_back(i);
+        x.push_front(-i);}
+    ASSERT_EQ(40, x.size());
+    ASSERT_EQ(-19, x.front());
+    ASSERT_EQ(19, x.back());
+    ASSERT_EQ(0, x[19]);
+    ASSERT_EQ(0, x[20]);
+    x.pop_front();
+    x.pop_back();
+    ASSERT_EQ(-18, x.front());
+    ASSERT_EQ(18, x.back());
+    ASSERT_THROW(x.at(38), std::out_of_range);}
+
+TEST(TestMappedDeque, Random_1) {
+    scratch_file f("Random_1");
+    mapped_deque<long, 4> x(f.path);
+    std::deque<long>      y;
+    unsigned r = 4321;
+    for (int i = 0; i != 50000; ++i) {
+        r = (r * 1103515245) + 12345;
+        switch ((r >> 16) % 5) {
+            case 0: x.push_back(i);  y.push_back(i);  break;
+            case 1: x.push_front(i); y.push_front(i); break;
+            case 2: if (!y.empty()) {x.pop_back();  y.pop_back();}  break;
+            case 3: if (!y.empty()) {x.pop_front(); y.pop_front();} break;
+            default: x.push_back(-i); y.push_back(-i);}}
+    ASSERT_EQ(y.size(), x.size());
+    for (std::size_t i = 0; i != y.size(); ++i)
+        ASSERT_EQ(y[i], x[i]);}
+
+// ------
+// Reopen
+// ------
+
+TEST(TestMappedDeque, Reopen_1) {
+    scratch_file f("Reopen_1");
+    {
+    mapped_deque<double, 16> x(f.path);
+    for (int i = 0; i != 1000; ++i) {
+        x.push_back(i / 4.0);
+        x.push_front(-i / 4.0);}
+    x.pop_front();
+    x.flush();
+    }
+    mapped_deque<double, 16> x(f.path);
+    ASSERT_EQ(1999, x.size());
+    ASSERT_EQ(-998 / 4.0, x.front());
+    ASSERT_EQ(999 / 4.0, x.back());
+    x.push_front(7);
+    ASSERT_EQ(2000, x.size());
+    ASSERT_EQ(7, x[0]);}
+
+TEST(TestMappedDeque, Reopen_2) {
+    scratch_file f("Reopen_2");
+    {
+    mapped_deque<int, 16> x(f.path);
+    x.push_back(1);
+    }
+    ASSERT_THROW((mapped_deque<int, 32>(f.path)), std::invalid_argument);
+    ASSERT_THROW((mapped_deque<double, 16>(f.path)), std::invalid_argument);
+    ASSERT_THROW((mapped_deque<int, 16>("/nonexistent/dir/x.bin")), std::system_error);}
+
+// -------
+// Recycle
+// -------
+
+TEST(TestMappedDeque, Recycle_1) {
+    scratch_file f("Recycle_1");
+    mapped_deque<int, 16> x(f.path);
+    for (int i = 0; i != 100; ++i)
+        x.push_back(i);
+    const std::size_t b = x.bytes();
+    for (int i = 0; i != 100000; ++i) {
+        x.push_back(i);
+        x.pop_front();}
+    ASSERT_EQ(b, x.bytes());
+    ASSERT_EQ(100, x.size());
+    ASSERT_EQ(99999, x.back());
+    x.clear();
+    ASSERT_TRUE(x.empty());
+    x.push_front(3);
+    ASSERT_EQ(3, x.back());}
+
+// *********** Serialization ************ //
+
+/**
+ * An O_RDWR file descriptor on a scratch file, rewound with rewind().
+ */
+struct scratch_fd {
+    scratch_file f;
+    int          fd;
+
+    explicit scratch_fd (const std::string& name) :
+            f  (name),
+            fd (::open(f.path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644))
+        {}
+
+    ~scratch_fd () {
+        ::close(fd);}
+
+    void rewind () {
+        ::lseek(fd, 0, SEEK_SET);}};
+
+// ---------
+// Roundtrip
+// ---------
+
+TEST(TestDequeIO, Roundtrip_1) {
+    scratch_fd s("Roundtrip_1");
+    my_deque<int, std::allocator<int>, 16> x;
+    for (int i = 0; i != 1000; ++i) {
+        x.push_back(i);
+        x.push_front(-i);}
+    write_deque(s.fd, x);
+    s.rewind();
+    my_deque<int, std::allocator<int>, 7> y(3, 9);
+    read_deque(s.fd, y);
+    ASSERT_EQ(2003, y.size());
+    ASSERT_EQ(9, y[2]);
+    ASSERT_TRUE(std::equal(x.begin(), x.end(), y.begin() + 3));}
+
+TEST(TestDequeIO, Roundtrip_2) {
+    scratch_fd s("Roundtrip_2");
+    const my_deque<point> x;
+    write_deque(s.fd, x);
+    s.rewind();
+    my_deque<point> y;
+    read_deque(s.fd, y);
+    ASSERT_TRUE(y.empty());}
+
+TEST(TestDequeIO, Roundtrip_3) {
+    int p[2];
+    ASSERT_EQ(0, ::pipe(p));
+    my_deque<double> x;
+    int i = 0;
+    x.append_n(100000, [&] () {return i++ / 8.0;});
+    std::thread w([&] () {
+        write_deque(p[1], x);
+        ::close(p[1]);});
+    my_deque<double> y;
+    read_deque(p[0], y);
+    w.join();
+    ::close(p[0]);
+    ASSERT_TRUE(x == y);}
+
+// -----
+// Error
+// -----
+
+TEST(TestDequeIO, Error_1) {
+    scratch_fd s("Error_1");
+    my_deque<int> x(100, 5);
+    write_deque(s.fd, x);
+    s.rewind();
+    my_deque<double> y;
+    ASSERT_THROW(read_deque(s.fd, y), std::runtime_error);
+    ASSERT_EQ(0, ::ftruncate(s.fd, deque_header::bytes + 40));
+    s.rewind();
+    my_deque<int> z(2, 1);
+    ASSERT_THROW(read_deque(s.fd, z), std::runtime_error);
+    ASSERT_EQ(2, z.size());}
+
+// -------
+// Decoder
+// -------
+
+TEST(TestDequeIO, Decoder_1) {
+    scratch_fd s("Decoder_1");
+    my_deque<point, std::allocator<point>, 4> x;
+    for (int i = 0; i != 50; ++i) {
+        const point q = {i, i * 1.5};
+        x.push_back(q);}
+    write_deque(s.fd, x);
+    s.rewind();
+    std::vector<char> b(deque_header::bytes + (50 * sizeof(point)));
+    ASSERT_EQ(b.size(), ::read(s.fd, b.data(), b.size()));
+    deque_decoder<point, std::allocator<point>, 4> d;
+    std::size_t i = 0;
+    for (; i != deque_header::bytes + sizeof(point) + 3; ++i)
+        d.feed(&b[i], 1);
+    ASSERT_EQ(50, d.expected());
+    ASSERT_EQ(1, d.deque().size());
+    ASSERT_EQ(0, d.deque().front().x);
+    d.deque().pop_front();
+    d.feed(&b[i], 400);
+    i += 400;
+    ASSERT_FALSE(d.done());
+    ASSERT_EQ(1.5, d.deque().front().y);
+    d.feed(&b[i], b.size() - i);
+    ASSERT_TRUE(d.done());
+    ASSERT_EQ(49, d.deque().size());
+    ASSERT_EQ(49, d.deque().back().x);
+    ASSERT_THROW(d.feed(&b[0], 1), std::runtime_error);}
+
+TEST(TestDequeIO, Decoder_2) {
+    int p[2];
+    ASSERT_EQ(0, ::pipe(p));
+    my_deque<long> x;
+    for (long i = 0; i != 20000; ++i)
+        x.push_back(i * i);
+    std::thread w([&] () {
+        write_deque(p[1], x);
+        ::close(p[1]);});
+    deque_decoder<long> d;
+    long sum = 0;
+    while (d.read_some(p[0], 1000))
+        while (!d.deque().empty()) {
+            sum += d.deque().front();
+            d.deque().pop_front();}
+    w.join();
+    ::close(p[0]);
+    ASSERT_TRUE(d.done());
+    ASSERT_EQ(std::accumulate(x.begin(), x.end(), 0L), sum);}
+
+// *********** Small Deque ************ //
+
+typedef small_deque<int, 8, counting_allocator<int>, 4> counted_small_deque;
+
+// ------
+// Inline
+// ------
+
+TEST(TestSmallDeque, Inline_1) {
+    allocation_counts::reset();
+    {
+    counted_small_deque x;
+    for (int i = 0; i != 4; ++i) {
+        x.push_back(i);
+        x.push_front(-i - 1);}
+    ASSERT_TRUE(x.is_inline());
+    ASSERT_EQ(8u, x.size());
+    ASSERT_EQ(-4, x.front());
+    ASSERT_EQ( 3, x.back());
+    for (int i = 0; i != 8; ++i)
+        ASSERT_EQ(i - 4, x[i]);
+    x.pop_front();
+    x.pop_back();
+    x.push_back(10);
+    x.push_front(11);
+    ASSERT_EQ(11, x.front());
+    ASSERT_EQ(10, x.back());
+    ASSERT_EQ(-3, x.at(1));
+    ASSERT_THROW(x.at(8), std::out_of_range);}
+    ASSERT_EQ(0u, allocation_counts::allocations);
+    ASSERT_EQ(0u, allocation_counts::maps);}
+
+TEST(TestSmallDeque, Inline_2) {
+    small_deque<std::string, 4> x;
+    for (int i = 0; i != 100; ++i) {
+        x.push_back(std::string(40, 'a' + (i % 26)));
+        if (x.size() == 4) {
+            x.pop_front();
+            x.pop_front();}}
+    ASSERT_TRUE(x.is_inline());
+    ASSERT_EQ(2u, x.size());
+    ASSERT_EQ(std::string(40, 'a' + (99 % 26)), x.back());}
+
+// -----
+// Spill
+// -----
+
+TEST(TestSmallDeque, Spill_1) {
+    allocation_counts::reset();
+    {
+    counted_small_deque x;
+    std::deque<int>     y;
+    for (int i = 0; i != 100; ++i)
+        if (i % 3) {
+            x.push_back(i);
+            y.push_back(i);}
+        else {
+            x.push_front(i);
+            y.push_front(i);}
+    ASSERT_FALSE(x.is_inline());
+    ASSERT_NE(0u, allocation_counts::allocations);
+    ASSERT_TRUE(std::equal(x.begin(), x.end(), y.begin()));
+    while (!x.empty())
+        x.pop_back();
+    ASSERT_FALSE(x.is_inline());}
+    ASSERT_EQ(0u, allocation_counts::live);}
+
+TEST(TestSmallDeque, Spill_2) {
+    small_deque<std::string, 2> x;
+    x.push_back(std::string(40, 'a'));
+    x.push_back(std::string(40, 'b'));
+    x.push_back(x.front());
+    x.push_front(x.back());
+    ASSERT_FALSE(x.is_inline());
+    ASSERT_EQ(4u, x.size());
+    ASSERT_EQ(std::string(40, 'a'), x[0]);
+    ASSERT_EQ(std::string(40, 'b'), x[2]);
+    ASSERT_EQ(std::string(40, 'a'), x[3]);}
+
+// ----
+// Copy
+// ----
+
+TEST(TestSmallDeque, Copy_1) {
+    small_deque<std::string, 4> x;
+    for (int i = 0; i != 3; ++i)
+        x.push_front(std::to_string(i));
+    small_deque<std::string, 4> y(x);
+    ASSERT_TRUE(y.is_inline());
+    ASSERT_TRUE(x == y);
+    for (int i = 0; i != 10; ++i)
+        y.push_back(std::to_string(i));
+    ASSERT_TRUE(x != y);
+    x = y;
+    ASSERT_FALSE(x.is_inline());
+    ASSERT_TRUE(x == y);}
+
+TEST(TestSmallDeque, Move_1) {
+    small_deque<std::string, 4> x;
+    x.push_back("abc");
+    x.push_back("def");
+    small_deque<std::string, 4> y(std::move(x));
+    ASSERT_TRUE(x.empty());
+    ASSERT_EQ(2u, y.size());
+    ASSERT_EQ("def", y.back());
+    for (int i = 0; i != 10; ++i)
+        x.push_back(std::to_string(i));
+    x.swap(y);
+    ASSERT_EQ(2u,  x.size());
+    ASSERT_EQ(10u, y.size());
+    ASSERT_EQ("9", y.back());
+    x = std::move(y);
+    ASSERT_EQ(10u, x.size());
+    ASSERT_EQ("0", x.front());}
+
+// -------------
+// Shrink_To_Fit
+// -------------
+
+TEST(TestSmallDeque, Shrink_To_Fit_1) {
+    allocation_counts::reset();
+    counted_small_deque x;
+    for (int i = 0; i != 50; ++i)
+        x.push_back(i);
+    while (x.size() > 8)
+        x.pop_front();
+    x.shrink_to_fit();
+    ASSERT_TRUE(x.is_inline());
+    ASSERT_EQ(0u, allocation_counts::live);
+    for (int i = 0; i != 8; ++i)
+        ASSERT_EQ(42 + i, x[i]);
+    x.push_back(50);
+    ASSERT_FALSE(x.is_inline());
+    ASSERT_EQ(9u, x.size());
+    x.reset();
+    ASSERT_TRUE(x.is_inline());
+    ASSERT_TRUE(x.empty());
+    ASSERT_EQ(0u, allocation_counts::live);}
+
+// --------
+// Iterator
+// --------
+
+TEST(TestSmallDeque, Iterator_1) {
+    small_deque<int, 8> x;
+    for (int i = 0; i != 6; ++i) {
+        x.push_front(i);
+        x.pop_back();
+        x.push_front(i);
+        x.push_back(i);}
+    std::sort(x.begin(), x.end());
+    ASSERT_TRUE(std::is_sorted(x.begin(), x.end()));
+    const small_deque<int, 8>& y = x;
+    small_deque<int, 8>::const_iterator b = x.begin();
+    ASSERT_TRUE(b == y.begin());
+    ASSERT_EQ(x.size(), std::size_t(y.end() - b));
+    for (int i = 0; i != 30; ++i)
+        x.push_front(i);
+    std::sort(x.begin(), x.end());
+    ASSERT_TRUE(std::is_sorted(y.begin(), y.end()));}
+
+// *********** Stats ************ //
+
+typedef my_deque<int, counting_allocator<int>, 4, my_deque_stats> stats_deque;
+
+// ----
+// Size
+// ----
+
+TEST(TestDequeStats, Size_1) {
+    ASSERT_TRUE(std::is_empty<my_deque_no_stats>::value);
+    ASSERT_EQ(sizeof(my_deque<int>) + sizeof(my_deque_stats),
+              sizeof(my_deque<int, std::allocator<int>, my_deque_block_size<int>::value, my_deque_stats>));
+    my_deque<int> x(10, 2);
+    x.stats();}
+
+// ------
+// Blocks
+// ------
+
+TEST(TestDequeStats, Blocks_1) {
+    stats_deque x;
+    for (int i = 0; i != 100; ++i)
+        x.push_back(i);
+    my_deque_stats s = x.stats();
+    ASSERT_EQ(x.block_allocations(), s.blocks_allocated);
+    ASSERT_EQ(25u, s.blocks_allocated);
+    ASSERT_EQ(25u, s.peak_blocks);
+    ASSERT_EQ(100u, s.peak_size);
+    ASSERT_LE(1u, s.maps_allocated);
+    ASSERT_LE(1u, s.slots_moved);
+    ASSERT_EQ(0u, s.blocks_freed);
+    while (!x.empty())
+        x.pop_front();
+    s = x.stats();
+    ASSERT_EQ(24u - x.spare_blocks(), s.blocks_freed);
+    for (int i = 0; i != 8; ++i)
+        x.push_back(i);
+    s = x.stats();
+    ASSERT_EQ(1u,  s.blocks_reused);
+    ASSERT_EQ(25u, s.peak_blocks);
+    ASSERT_EQ(100u, s.peak_size);}
+
+// -----
+// Shift
+// -----
+
+TEST(TestDequeStats, Shift_1) {
+    stats_deque x;
+    for (int i = 0; i != 10; ++i)
+        x.push_back(i);
+    x.insert(x.begin() + 3, 42);
+    ASSERT_EQ(3u, x.stats().elements_shifted);
+    x.erase(x.begin() + 8);
+    ASSERT_EQ(5u, x.stats().elements_shifted);
+    const int a[] = {7, 8, 9};
+    x.insert(x.end() - 1, a, a + 3);
+    ASSERT_EQ(6u, x.stats().elements_shifted);}
+
+// ------
+// Wasted
+// ------
+
+TEST(TestDequeStats, Wasted_1) {
+    stats_deque x;
+    ASSERT_EQ(0u, x.stats().wasted_bytes);
+    x.push_back(1);
+    ASSERT_EQ(3 * sizeof(int), x.stats().wasted_bytes);
+    for (int i = 0; i != 4; ++i)
+        x.push_back(i);
+    ASSERT_EQ(3 * sizeof(int), x.stats().wasted_bytes);
+    x.pop_front();
+    ASSERT_EQ(4 * sizeof(int), x.stats().wasted_bytes);}
+
+// ---------
+// Aggregate
+// ---------
+
+TEST(TestDequeStats, Aggregate_1) {
+    stats_deque x(10, 1);
+    stats_deque y(30, 1);
+    my_deque_stats s;
+    s += x.stats();
+    s += y.stats();
+    ASSERT_EQ(11u, s.blocks_allocated);
+    ASSERT_EQ(30u, s.peak_size);
+    std::ostringstream out;
+    out << s;
+    ASSERT_NE(std::string::npos, out.str().find("blocks_allocated=11 "));
+    ASSERT_NE(std::string::npos, out.str().find("peak_size=30 "));}
+
+TEST(TestDequeStats, Move_1) {
+    stats_deque x(10, 1);
+    stats_deque y(std::move(x));
+    ASSERT_EQ(0u, x.stats().blocks_allocated);
+    ASSERT_EQ(3u, y.stats().blocks_allocated);
+    x.swap(y);
+    ASSERT_EQ(3u, x.stats().blocks_allocated);
+    stats_deque z(x);
+    ASSERT_EQ(3u, z.stats().blocks_allocated);
+    ASSERT_EQ(10u, z.stats().peak_size);}
+
+// *********** Bounded Deque ************ //
+
+typedef bounded_deque<int, counting_allocator<int>, 4> counted_bounded_deque;
+
+// ------
+// Reject
+// ------
+
+TEST(TestBoundedDeque, Reject_1) {
+    allocation_counts::reset();
+    counted_bounded_deque x(10);
+    ASSERT_EQ(3u, allocation_counts::allocations);
+    ASSERT_EQ(10u, x.capacity());
+    for (int i = 0; i != 5; ++i) {
+        ASSERT_TRUE(x.try_push_back(i));
+        ASSERT_TRUE(x.try_push_front(-i - 1));}
+    ASSERT_TRUE(x.full());
+    ASSERT_FALSE(x.try_push_back(99));
+    ASSERT_FALSE(x.try_push_front(99));
+    for (int i = 0; i != 10; ++i)
+        ASSERT_EQ(i - 5, x[i]);
+    ASSERT_THROW(x.at(10), std::out_of_range);
+    ASSERT_EQ(3u, allocation_counts::allocations);}
+
+TEST(TestBoundedDeque, Reject_2) {
+    allocation_counts::reset();
+    {
+    counted_bounded_deque x(13);
+    std::deque<int>       y;
+    unsigned r = 1;
+    for (int i = 0; i != 10000; ++i) {
+        r = (r * 1103515245u) + 12345u;
+        switch ((r >> 16) % 4) {
+            case 0:
+                ASSERT_EQ(y.size() != 13, x.try_push_back(i));
+                if (y.size() != 13)
+                    y.push_back(i);
+                break;
+            case 1:
+                ASSERT_EQ(y.size() != 13, x.try_push_front(i));
+                if (y.size() != 13)
+                    y.push_front(i);
+                break;
+            case 2:
+                if (!y.empty()) {
+                    x.pop_back();
+                    y.pop_back();}
+                break;
+            default:
+                if (!y.empty()) {
+                    x.pop_front();
+                    y.pop_front();}}
+        ASSERT_EQ(y.size(), x.size());
+        if (!y.empty()) {
+            ASSERT_EQ(y.front(), x.front());
+            ASSERT_EQ(y.back(),  x.back());}}
+    ASSERT_EQ(4u, allocation_counts::allocations);}
+    ASSERT_EQ(0u, allocation_counts::live);}
+
+TEST(TestBoundedDeque, Reject_3) {
+    bounded_deque<int> x(0, bounded_deque_overwrite);
+    ASSERT_TRUE(x.full());
+    ASSERT_FALSE(x.try_push_back(1));
+    ASSERT_FALSE(x.try_push_front(1));
+    ASSERT_TRUE(x.empty());}
+
+// ---------
+// Overwrite
+// ---------
+
+TEST(TestBoundedDeque, Overwrite_1) {
+    bounded_deque<int, std::allocator<int>, 4> x(5, bounded_deque_overwrite);
+    for (int i = 0; i != 10; ++i)
+        ASSERT_TRUE(x.try_push_back(i));
+    ASSERT_EQ(5u, x.size());
+    for (int i = 0; i != 5; ++i)
+        ASSERT_EQ(i + 5, x[i]);
+    ASSERT_TRUE(x.try_push_front(100));
+    ASSERT_EQ(100, x.front());
+    ASSERT_EQ(8,   x.back());}
+
+TEST(TestBoundedDeque, Overwrite_2) {
+    bounded_deque<std::string, std::allocator<std::string>, 2> x(3, bounded_deque_overwrite);
+    x.try_push_back(std::string(40, 'a'));
+    x.try_push_back(std::string(40, 'b'));
+    x.try_push_back(std::string(40, 'c'));
+    ASSERT_TRUE(x.try_push_back(x.front()));
+    ASSERT_EQ(std::string(40, 'b'), x.front());
+    ASSERT_EQ(std::string(40, 'a'), x.back());
+    ASSERT_TRUE(x.try_push_front(x.back()));
+    ASSERT_EQ(std::string(40, 'a'), x.front());
+    ASSERT_EQ(std::string(40, 'c'), x.back());}
+
+// *********** Copy-on-Write Deque ************ //
+
+// ------------
+// tracked_int
+// ------------
+
+struct tracked_int {
+    static int live;
+    int v;
+
+    tracked_int (int w) : v(w) {
+        ++live;}
+
+    tracked_int (const tracked_int& that) : v(that.v) {
+        ++live;}
+
+    ~tracked_int () {
+        --live;}};
+
+int tracked_int::live = 0;
+
+typedef cow_deque<int, counting_allocator<int>, 16> counted_cow_deque;
+
+// --------
+// Snapshot
+// --------
+
+TEST(TestCowDeque, Snapshot_1) {
+    counted_cow_deque x;
+    const counted_cow_deque& cx = x;
+    for (int i = 0; i != 1000; ++i)
+        x.push_back(i);
+    allocation_counts::reset();
+    const counted_cow_deque s = x.snapshot();
+    ASSERT_EQ(0u, allocation_counts::allocations);
+    ASSERT_EQ(63u, s.shared_blocks());
+    ASSERT_EQ(&cx[0], &s[0]);
+    x[500] = -1;
+    ASSERT_EQ(1u, allocation_counts::allocations);
+    ASSERT_EQ(62u, x.shared_blocks());
+    ASSERT_EQ(-1,  x[500]);
+    ASSERT_EQ(500, s[500]);
+    ASSERT_EQ(&cx[0],   &s[0]);
+    ASSERT_NE(&cx[500], &s[500]);
+    ASSERT_EQ(&cx[999], &s[999]);
+    x.push_back(1000);
+    ASSERT_EQ(2u, allocation_counts::allocations);
+    ASSERT_EQ(1000u, s.size());
+    ASSERT_EQ(999, s.back());}
+
+TEST(TestCowDeque, Snapshot_2) {
+    counted_cow_deque x;
+    for (int i = 0; i != 100; ++i)
+        x.push_front(i);
+    counted_cow_deque y = x;
+    y.pop_front();
+    y.pop_back();
+    ASSERT_EQ(7u, x.shared_blocks());
+    y.push_front(7);
+    ASSERT_EQ(7, y.front());
+    ASSERT_EQ(99, x.front());
+    ASSERT_EQ(6u, x.shared_blocks());
+    x = y;
+    ASSERT_EQ(&static_cast<const counted_cow_deque&>(x).back(), &static_cast<const counted_cow_deque&>(y).back());
+    std::size_t n = 0;
+    long sum = 0;
+    y.for_each_block([&] (const int* p, std::size_t k) {
+        n += k;
+        sum += std::accumulate(p, p + k, 0L);});
+    ASSERT_EQ(y.size(), n);
+    ASSERT_EQ(7 + (4950 - 99 - 0), sum);}
+
+// -----
+// Model
+// -----
+
+TEST(TestCowDeque, Model_1) {
+    typedef cow_deque<tracked_int, std::allocator<tracked_int>, 4> tracked_deque;
+    {
+    tracked_deque x;
+    const tracked_deque& cx = x;
+    std::deque<int> mx;
+    std::vector<tracked_deque> s;
+    std::vector<std::deque<int> > ms;
+    unsigned r = 7;
+    for (int i = 0; i != 5000; ++i) {
+        r = (r * 1103515245u) + 12345u;
+        switch ((r >> 16) % 7) {
+            case 0:
+                x.push_back(i);
+                mx.push_back(i);
+                break;
+            case 1:
+                x.push_front(i);
+                mx.push_front(i);
+                break;
+            case 2:
+                if (!mx.empty()) {
+                    x.pop_back();
+                    mx.pop_back();}
+                break;
+            case 3:
+                if (!mx.empty()) {
+                    x.pop_front();
+                    mx.pop_front();}
+                break;
+            case 4:
+                if (!mx.empty()) {
+                    x[(r >> 8) % mx.size()].v = -i;
+                    mx[(r >> 8) % mx.size()]  = -i;}
+                break;
+            case 5:
+                if (s.size() < 8) {
+                    s.push_back(x.snapshot());
+                    ms.push_back(mx);}
+                break;
+            default:
+                if (!s.empty()) {
+                    const std::size_t k = (r >> 8) % s.size();
+                    if (!s[k].empty()) {
+                        s[k].pop_front();
+                        ms[k].pop_front();}
+                    s.erase(s.begin() + (k % 2) * k);
+                    ms.erase(ms.begin() + (k % 2) * k);}}
+        ASSERT_EQ(mx.size(), x.size());
+        for (std::size_t j = 0; j != mx.size(); ++j)
+            ASSERT_EQ(mx[j], cx[j].v);}
+    for (std::size_t k = 0; k != s.size(); ++k) {
+        ASSERT_EQ(ms[k].size(), s[k].size());
+        for (std::size_t j = 0; j != ms[k].size(); ++j)
+            ASSERT_EQ(ms[k][j], s[k].at(j).v);}}
+    ASSERT_EQ(0, tracked_int::live);}
+
+// ------
+// Thread
+// ------
+
+TEST(TestCowDeque, Thread_1) {
+    cow_deque<long> x;
+    for (long i = 0; i != 100000; ++i)
+        x.push_back(i);
+    cow_deque<long> s = x.snapshot();
+    long sum = 0;
+    std::thread t([&sum] (cow_deque<long> y) {
+        y.for_each_block([&sum] (const long* p, std::size_t k) {
+            sum = std::accumulate(p, p + k, sum);});},
+        std::move(s));
+    for (long i = 0; i < 100000; i += 7)
+        x[i] = -1;
+    while (!x.empty())
+        x.pop_front();
+    t.join();
+    ASSERT_EQ(4999950000L, sum);}
@@ -0,0 +1,463 @@
+// ----------------------------------
+// projects/deque/WorkStealingDeque.h
+// Copyright (C) 2014
+// Glenn P. Downing
+// ----------------------------------
+
+#ifndef WorkStealingDeque_h
+#define WorkStealingDeque_h
+
+// --------
+// includes
+// --------
+
+#include <atomic>      // atomic, memory_order_acquire, memory_order_relaxed, memory_order_release, memory_order_seq_cst
+#include <cassert>     // assert
+#include <cstddef>     // ptrdiff_t, size_t
+#include <functional>  // function
+#include <memory>      // allocator, allocator_traits, unique_ptr
+#include <mutex>       // lock_guard, mutex
+#include <new>         // placement new
+#include <thread>      // thread, yield
+#include <type_traits> // is_trivially_copyable
+#include <utility>     // move
+#include <vector>      // vector
+
+#include "Deque.h"
+
+// -------------------
+// work_stealing_deque
+// -------------------
+
+/**
+ * Chase-Lev work-stealing deque. One owner thread pushes and pops at the
+ * back without waiting; any number of thieves take from the front with
+ * a compare-and-swap on the front index. The elements live in blocks of
+ * B slots, as in my_deque, reached through a ring of block pointers:
+ * element i is in block (i / B) mod the ring size. When the owner runs
+ * out of room it builds a ring twice as big and moves block pointers, not
+ * elements, so thieves that still hold the old ring keep reading the
+ * same blocks and are never stopped. Old rings are kept until the deque
+ * is destroyed.
+ *
+ * Slots are std::atomic<T>, so T must be trivially copyable; it is
+ * meant for task pointers and handles.
+ */
+template < typename T, typename A = std::allocator<T>, std::size_t B = my_deque_block_size<T>::value >
+class work_stealing_deque {
+    public:
+        // --------
+        // typedefs
+        // --------
+
+        typedef A                                        allocator_type;
+        typedef typename allocator_type::value_type      value_type;
+
+        typedef typename allocator_type::size_type       size_type;
+        typedef typename allocator_type::difference_type difference_type;
+
+        // ---------
+        // constants
+        // ---------
+
+        static const size_type block_size = B;
+
+        static_assert(B > 0, "work_stealing_deque block size must be positive");
+        static_assert(std::is_trivially_copyable<T>::value, "work_stealing_deque needs a trivially copyable T");
+
+    private:
+        typedef std::atomic<T> slot;
+
+        typedef typename std::allocator_traits<A>::template rebind_alloc<slot>  slot_allocator_type;
+        typedef typename std::allocator_traits<A>::template rebind_alloc<slot*> map_allocator_type;
+
+        // ----
+        // ring
+        // ----
+
+        /**
+         * A power-of-two number of block pointers and the ring it replaced.
+         */
+        struct ring {
+            size_type size;
+            slot**    blocks;
+            ring*     older;
+
+            slot& at (difference_type i) const {
+                return blocks[(i / B) & (size - 1)][i % B];}};
+
+        // ----
+        // data
+        // ----
+
+        slot_allocator_type _sa;
+        map_allocator_type  _ma;
+
+        // padding instead of alignas, which C++11 new does not honor;
+        // the pool allocates its deques on the heap
+
+        char _p0[64];
+        std::atomic<difference_type> _top;      // next element to steal
+        char _p1[64];
+        std::atomic<difference_type> _bottom;   // next slot to push
+        std::atomic<ring*> _ring;
+
+        // --------------
+        // allocate_block
+        // --------------
+
+        slot* allocate_block () {
+            slot* const p = _sa.allocate(B);
+            for (size_type i = 0; i != B; ++i)
+                ::new (static_cast<void*>(p + i)) slot();
+            return p;}
+
+        // --------
+        // new_ring
+        // --------
+
+        ring* new_ring (size_type n, ring* older) {
+            ring* const r = new ring;
+            r->size   = n;
+            r->blocks = _ma.allocate(n);
+            r->older  = older;
+            return r;}
+
+        // ----
+        // grow
+        // ----
+
+        /**
+         * Owner: a ring twice the size of r. The blocks holding [t, b]
+         * keep their block numbers, the rest of r's blocks fill the free
+         * slots and new blocks fill what is left.
+         */
+        ring* grow (ring* r, difference_type t, difference_type b) {
+            const size_type n  = 2 * r->size;
+            ring* const     s  = new_ring(n, r);
+            std::vector<bool> used(r->size, false);
+            std::vector<bool> set(n, false);
+            const difference_type d = B;
+            for (difference_type j = t / d; j <= (b / d); ++j) {
+                s->blocks[j & (n - 1)] = r->blocks[j & (r->size - 1)];
+                set[j & (n - 1)] = true;
+                used[j & (r->size - 1)] = true;}
+            size_type k = 0;
+            for (size_type i = 0; i != n; ++i)
+                if (!set[i]) {
+                    while ((k != r->size) && used[k])
+                        ++k;
+                    s->blocks[i] = (k != r->size) ? r->blocks[k++] : allocate_block();}
+            _ring.store(s, std::memory_order_release);
+            return s;}
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        explicit work_stealing_deque (const allocator_type& a = allocator_type()) :
+                _sa     (a),
+                _ma     (a),
+                _top    (0),
+                _bottom (0),
+                _ring   (0) {
+            ring* const r = new_ring(2, 0);
+            for (size_type i = 0; i != r->size; ++i)
+                r->blocks[i] = allocate_block();
+            _ring.store(r, std::memory_order_relaxed);}
+
+        work_stealing_deque             (const work_stealing_deque&) = delete;
+        work_stealing_deque& operator = (const work_stealing_deque&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+        /**
+         * No thread may be using the deque.
+         */
+        ~work_stealing_deque () {
+            ring* r = _ring.load(std::memory_order_relaxed);
+            for (size_type i = 0; i != r->size; ++i)
+                _sa.deallocate(r->blocks[i], B);
+            while (r) {
+                ring* const o = r->older;
+                _ma.deallocate(r->blocks, r->size);
+                delete r;
+                r = o;}}
+
+        // --------
+        // capacity
+        // --------
+
+        /**
+         * Elements the current ring can hold before the next growth.
+         */
+        size_type capacity () const {
+            return (_ring.load(std::memory_order_acquire)->size - 1) * B;}
+
+        // ---------
+        // push_back
+        // ---------
+
+        /**
+         * Owner: adds v at the back.
+         */
+        void push_back (const value_type& v) {
+            const difference_type b = _bottom.load(std::memory_order_relaxed);
+            const difference_type t = _top.load(std::memory_order_acquire);
+            ring* r = _ring.load(std::memory_order_relaxed);
+            if (((b / B) - (t / B)) >= (r->size - 1))
+                r = grow(r, t, b);
+            r->at(b).store(v, std::memory_order_relaxed);
+            _bottom.store(b + 1, std::memory_order_release);}
+
+        // --------
+        // pop_back
+        // --------
+
+        /**
+         * Owner: takes the back element into v; false if there was none,
+         * or a thief took the last one first.
+         */
+        bool pop_back (value_type& v) {
+            const difference_type b = _bottom.load(std::memory_order_relaxed) - 1;
+            ring* const r = _ring.load(std::memory_order_relaxed);
+            _bottom.store(b, std::memory_order_seq_cst);
+            difference_type t = _top.load(std::memory_order_seq_cst);
+            if (t > b) {
+                _bottom.store(b + 1, std::memory_order_relaxed);
+                return false;}
+            v = r->at(b).load(std::memory_order_relaxed);
+            if (t != b)
+                return true;
+            const bool won = _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return won;}
+
+        // -----------
+        // steal_front
+        // -----------
+
+        /**
+         * Thief: takes the front element into v; false if the deque looked
+         * empty or another thread took the element first.
+         */
+        bool steal_front (value_type& v) {
+            difference_type       t = _top.load(std::memory_order_seq_cst);
+            const difference_type b = _bottom.load(std::memory_order_seq_cst);
+            if (t >= b)
+                return false;
+            const value_type x = _ring.load(std::memory_order_acquire)->at(t).load(std::memory_order_relaxed);
+            if (!_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return false;
+            v = x;
+            return true;}
+
+        // ----
+        // size
+        // ----
+
+        /**
+         * Number of elements; only a snapshot while other threads run.
+         */
+        size_type size () const {
+            const difference_type t = _top.load(std::memory_order_acquire);
+            const difference_type b = _bottom.load(std::memory_order_acquire);
+            return (b > t) ? (b - t) : 0;}
+
+        bool empty () const {
+            return size() == 0;}};
+
+// ------------------
+// work_stealing_pool
+// ------------------
+
+/**
+ * Small thread pool on top of work_stealing_deque: every worker owns a
+ * deque of tasks, runs its own tasks newest first and, when it has none,
+ * steals the oldest task of another worker or takes one submitted from
+ * outside. Tasks running on a worker add more with spawn, which goes to
+ * that worker's deque without a lock; submit from any other thread goes
+ * through a locked queue.
+ */
+class work_stealing_pool {
+    public:
+        typedef std::function<void ()> task;
+
+    private:
+        // ----
+        // data
+        // ----
+
+        typedef work_stealing_deque<task*> deque_type;
+
+        std::vector< std::unique_ptr<deque_type> > _deques;
+        std::vector<std::thread>                   _threads;
+
+        std::mutex       _m;
+        my_deque<task*>  _submitted;
+
+        std::atomic<std::size_t> _pending;
+        std::atomic<bool>        _stop;
+
+        // ------------
+        // worker_index
+        // ------------
+
+        /**
+         * Index of the calling worker in the pool it belongs to, and that
+         * pool; 0 for threads outside any pool.
+         */
+        static std::size_t& worker_index () {
+            static thread_local std::size_t i = 0;
+            return i;}
+
+        static work_stealing_pool*& worker_pool () {
+            static thread_local work_stealing_pool* p = 0;
+            return p;}
+
+        // ----
+        // find
+        // ----
+
+        /**
+         * A task for worker w: its own newest, another worker's oldest,
+         * or the oldest submitted from outside; 0 if there is none.
+         */
+        task* find (std::size_t w, std::size_t& seed) {
+            task* t = 0;
+            if (_deques[w]->pop_back(t))
+                return t;
+            const std::size_t n = _deques.size();
+            seed = (seed * 6364136223846793005ull) + 1442695040888963407ull;
+            for (std::size_t i = 0; i != n; ++i) {
+                const std::size_t v = ((seed >> 33) + i) % n;
+                if ((v != w) && _deques[v]->steal_front(t))
+                    return t;}
+            std::lock_guard<std::mutex> lock(_m);
+            if (_submitted.empty())
+                return 0;
+            t = _submitted.front();
+            _submitted.pop_front();
+            return t;}
+
+        // ---
+        // run
+        // ---
+
+        void run (task* t) {
+            (*t)();
+            delete t;
+            _pending.fetch_sub(1, std::memory_order_acq_rel);}
+
+        // ----
+        // work
+        // ----
+
+        void work (std::size_t w) {
+            worker_index() = w;
+            worker_pool()  = this;
+            std::size_t seed = w + 1;
+            while (!_stop.load(std::memory_order_acquire)) {
+                if (task* const t = find(w, seed))
+                    run(t);
+                else
+                    std::this_thread::yield();}}
+
+    public:
+        // ------------
+        // constructors
+        // ------------
+
+        /**
+         * Starts n workers.
+         */
+        explicit work_stealing_pool (std::size_t n = std::thread::hardware_concurrency()) :
+                _pending (0),
+                _stop    (false) {
+            if (n == 0)
+                n = 1;
+            for (std::size_t i = 0; i != n; ++i)
+                _deques.push_back(std::unique_ptr<deque_type>(new deque_type));
+            for (std::size_t i = 0; i != n; ++i)
+                _threads.push_back(std::thread(&work_stealing_pool::work, this, i));}
+
+        work_stealing_pool             (const work_stealing_pool&) = delete;
+        work_stealing_pool& operator = (const work_stealing_pool&) = delete;
+
+        // ----------
+        // destructor
+        // ----------
+
+        /**
+         * Finishes every task, then stops the workers.
+         */
+        ~work_stealing_pool () {
+            wait();
+            _stop.store(true, std::memory_order_release);
+            for (std::size_t i = 0; i != _threads.size(); ++i)
+                _threads[i].join();}
+
+        // -----
+        // spawn
+        // -----
+
+        /**
+         * Adds f to the calling worker's deque, or submits it if the
+         * caller is not one of this pool's workers.
+         */
+        void spawn (task f) {
+            if (worker_pool() != this) {
+                submit(std::move(f));
+                return;}
+            _pending.fetch_add(1, std::memory_order_acq_rel);
+            _deques[worker_index()]->push_back(new task(std::move(f)));}
+
+        // ------
+        // submit
+        // ------
+
+        /**
+         * Queues f for whichever worker gets to it first.
+         */
+        void submit (task f) {
+            _pending.fetch_add(1, std::memory_order_acq_rel);
+            std::lock_guard<std::mutex> lock(_m);
+            _submitted.push_back(new task(std::move(f)));}
+
+        // ----
+        // size
+        // ----
+
+        std::size_t size () const {
+            return _threads.size();}
+
+        // ----
+        // wait
+        // ----
+
+        /**
+         * Returns once every task spawned or submitted so far, and every
+         * task those spawn, has run. A worker that waits runs tasks
+         * meanwhile instead of blocking.
+         */
+        void wait () {
+            wait(_pending);}
+
+        /**
+         * Returns once n drops to zero, n being a count of outstanding
+         * tasks kept by the caller; a worker that waits runs tasks
+         * meanwhile instead of blocking.
+         */
+        void wait (const std::atomic<std::size_t>& n) {
+            std::size_t seed = 1;
+            while (n.load(std::memory_order_acquire) != 0) {
+                if (worker_pool() == this) {
+                    if (task* const t = find(worker_index(), seed)) {
+                        run(t);
+                        continue;}}
+                std::this_thread::yield();}}};
+
+#endif // WorkStealingDeque_h